@@ -6,11 +6,12 @@ import sys
 
 filePath = sys.argv[1]
 batchSize = int(sys.argv[2])
+url = sys.argv[3] if len(sys.argv) > 3 else "ws://localhost:8080/translate"
 #print filePath
 #print batchSize
 
 def translate( batch ):
-  ws = create_connection("ws://localhost:8080/translate")
+  ws = create_connection(url)
 
   #batch = batch[:-1]
   #print batch
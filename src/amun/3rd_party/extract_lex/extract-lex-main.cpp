@@ -22,10 +22,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <cassert>
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <sys/resource.h>
 
 #include "file_stream.h"
 #include "utils.h"
 #include "extract-lex.h"
+#include "parallel-extract-lex.h"
 
 float COUNT_INCR = 1;
 
@@ -35,16 +38,46 @@ void fix(std::ostream& stream)
   stream.precision(7);
 }
 
+void usage(const char* name)
+{
+  std::cerr << "Usage: " << name << " [--threads N] [--top N] target source align lex.s2t lex.t2s\n"
+            << "  --threads N  count with N threads, words as integer ids\n"
+            << "  --top N      with --threads, keep only the N most probable translations per word\n";
+}
+
+// Maximum resident set size of this process so far, in MB
+double PeakMemory()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024.0;
+}
+
 int main(int argc, char* argv[])
 {
+  size_t threads = 0, topN = 0;
+  std::vector<char*> args;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if ((arg == "--threads" || arg == "--top") && i + 1 < argc) {
+      (arg == "--threads" ? threads : topN) = std::stoul(argv[++i]);
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+  if (args.size() != 5 || (topN > 0 && threads == 0)) {
+    usage(argv[0]);
+    return 1;
+  }
+
   std::cerr << "Starting...\n";
+  auto start = std::chrono::steady_clock::now();
 
-  assert(argc == 6);
-  char* &filePathTarget = argv[1];
-  char* &filePathSource = argv[2];
-  char* &filePathAlign  = argv[3];
-  char* &filePathLexS2T = argv[4];
-  char* &filePathLexT2S = argv[5];
+  char* &filePathTarget = args[0];
+  char* &filePathSource = args[1];
+  char* &filePathAlign  = args[2];
+  char* &filePathLexS2T = args[3];
+  char* &filePathLexT2S = args[4];
 
   InputFileStream streamTarget(filePathTarget);
   InputFileStream streamSource(filePathSource);
@@ -58,35 +91,43 @@ int main(int argc, char* argv[])
   fix(streamLexS2T);
   fix(streamLexT2S);
 
-  extract::ExtractLex extractSingleton;
-
   size_t lineCount = 0;
-  std::string lineTarget, lineSource, lineAlign;
-  while (std::getline((std::istream&)streamTarget, lineTarget)) {
-    if (lineCount % 10000 == 0)
-      std::cerr << lineCount << " ";
-
-    std::istream &isSource = std::getline((std::istream&)streamSource, lineSource);
-    assert(isSource);
-    std::istream &isAlign = std::getline((std::istream&)streamAlign, lineAlign);
-    assert(isAlign);
-
-    std::vector<std::string> toksTarget, toksSource, toksAlign;
-    Split(lineTarget, toksTarget, " ");
-    Split(lineSource, toksSource, " ");
-    Split(lineAlign, toksAlign, " ");
-
-    extractSingleton.Process(toksTarget, toksSource, toksAlign, lineCount);
+  if (threads > 0) {
+    extract::ParallelExtractLex extractParallel(threads, topN);
+    lineCount = extractParallel.Process(streamTarget, streamSource, streamAlign);
+    extractParallel.Output(streamLexS2T, streamLexT2S);
+  } else {
+    extract::ExtractLex extractSingleton;
+
+    std::string lineTarget, lineSource, lineAlign;
+    while (std::getline((std::istream&)streamTarget, lineTarget)) {
+      if (lineCount % 10000 == 0)
+        std::cerr << lineCount << " ";
+
+      std::istream &isSource = std::getline((std::istream&)streamSource, lineSource);
+      assert(isSource);
+      std::istream &isAlign = std::getline((std::istream&)streamAlign, lineAlign);
+      assert(isAlign);
+
+      std::vector<std::string> toksTarget, toksSource, toksAlign;
+      Split(lineTarget, toksTarget, " ");
+      Split(lineSource, toksSource, " ");
+      Split(lineAlign, toksAlign, " ");
+
+      extractSingleton.Process(toksTarget, toksSource, toksAlign, lineCount);
+
+      ++lineCount;
+    }
 
-    ++lineCount;
+    extractSingleton.Output(streamLexS2T, streamLexT2S);
   }
 
-  extractSingleton.Output(streamLexS2T, streamLexT2S);
-
   streamLexS2T.close();
   streamLexT2S.close();
 
-  std::cerr << "\nFinished\n";
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::cerr << "\nFinished " << lineCount << " sentence pairs in " << elapsed.count() << "s ("
+            << lineCount / elapsed.count() << " pairs/s), peak memory " << PeakMemory() << " MB\n";
 }
 
 const std::string *extract::Vocab::GetOrAdd(const std::string &word)
@@ -0,0 +1,297 @@
+#include "parallel-extract-lex.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include "utils.h"
+#include "exception.h"
+
+namespace extract {
+
+namespace {
+
+const size_t NUM_SHARDS = 64;
+const size_t BLOCK_LINES = 10000;
+
+uint64_t Key(uint32_t source, uint32_t target) {
+  return (uint64_t(source) << 32) | target;
+}
+
+size_t ShardOf(uint64_t key) {
+  return (key * 0x9E3779B97F4A7C15ull) >> 58;
+}
+
+}
+
+SharedVocab::SharedVocab(size_t numShards)
+  : m_shards(numShards)
+{}
+
+uint32_t SharedVocab::GetOrAdd(const std::string &word)
+{
+  size_t shard = std::hash<std::string>()(word) % m_shards.size();
+  Shard &s = m_shards[shard];
+
+  std::lock_guard<std::mutex> lock(s.mutex);
+  auto it = s.ids.find(word);
+  if (it != s.ids.end()) {
+    return it->second;
+  }
+  uint32_t id = s.words.size() * m_shards.size() + shard;
+  s.ids.emplace(word, id);
+  s.words.push_back(word);
+  return id;
+}
+
+const std::string &SharedVocab::operator[](uint32_t id) const
+{
+  return m_shards[id % m_shards.size()].words[id / m_shards.size()];
+}
+
+std::vector<uint32_t> SharedVocab::Ids() const
+{
+  std::vector<uint32_t> ids;
+  for (size_t shard = 0; shard < m_shards.size(); ++shard) {
+    for (size_t i = 0; i < m_shards[shard].words.size(); ++i) {
+      ids.push_back(i * m_shards.size() + shard);
+    }
+  }
+  return ids;
+}
+
+uint32_t SharedVocab::IdBound() const
+{
+  size_t bound = 0;
+  for (const auto &shard : m_shards) {
+    bound = std::max(bound, shard.words.size() * m_shards.size());
+  }
+  return bound;
+}
+
+ParallelExtractLex::ParallelExtractLex(size_t numThreads, size_t topN)
+  : m_numThreads(std::max<size_t>(numThreads, 1)),
+    m_topN(topN),
+    m_vocab(NUM_SHARDS),
+    m_null(m_vocab.GetOrAdd("NULL")),
+    m_counts(NUM_SHARDS),
+    m_countMutexes(NUM_SHARDS),
+    m_done(false)
+{}
+
+size_t ParallelExtractLex::Process(std::istream &streamTarget,
+                                   std::istream &streamSource,
+                                   std::istream &streamAlign)
+{
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < m_numThreads; ++i) {
+    workers.emplace_back(&ParallelExtractLex::Work, this);
+  }
+
+  size_t lineCount = 0;
+  Block block;
+  Line line;
+  while (std::getline(streamTarget, line.target)) {
+    if (lineCount % 10000 == 0)
+      std::cerr << lineCount << " ";
+
+    UTIL_THROW_IF2(!std::getline(streamSource, line.source), "Source is shorter than target");
+    UTIL_THROW_IF2(!std::getline(streamAlign, line.align), "Alignment is shorter than target");
+    block.push_back(std::move(line));
+    ++lineCount;
+
+    if (block.size() == BLOCK_LINES) {
+      Push(lineCount - block.size(), std::move(block));
+      block = Block();
+      block.reserve(BLOCK_LINES);
+    }
+  }
+  if (!block.empty()) {
+    Push(lineCount - block.size(), std::move(block));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    m_done = true;
+  }
+  m_notEmpty.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  return lineCount;
+}
+
+void ParallelExtractLex::Push(size_t firstLine, Block &&block)
+{
+  std::unique_lock<std::mutex> lock(m_queueMutex);
+  m_notFull.wait(lock, [this] { return m_queue.size() < 2 * m_numThreads; });
+  m_queue.emplace_back(firstLine, std::move(block));
+  lock.unlock();
+  m_notEmpty.notify_one();
+}
+
+bool ParallelExtractLex::Pop(size_t &firstLine, Block &block)
+{
+  std::unique_lock<std::mutex> lock(m_queueMutex);
+  m_notEmpty.wait(lock, [this] { return m_done || !m_queue.empty(); });
+  if (m_queue.empty()) {
+    return false;
+  }
+  firstLine = m_queue.front().first;
+  block = std::move(m_queue.front().second);
+  m_queue.pop_front();
+  lock.unlock();
+  m_notFull.notify_one();
+  return true;
+}
+
+void ParallelExtractLex::Work()
+{
+  // words this thread has seen, so the shared vocab is locked only for new ones
+  std::unordered_map<std::string, uint32_t> cache;
+  std::vector<Counts> local(NUM_SHARDS);
+
+  size_t firstLine;
+  Block block;
+  while (Pop(firstLine, block)) {
+    for (size_t i = 0; i < block.size(); ++i) {
+      Count(block[i], cache, local, firstLine + i);
+    }
+
+    for (size_t shard = 0; shard < NUM_SHARDS; ++shard) {
+      if (local[shard].empty()) {
+        continue;
+      }
+      std::lock_guard<std::mutex> lock(m_countMutexes[shard]);
+      Counts &counts = m_counts[shard];
+      for (const auto &count : local[shard]) {
+        counts[count.first] += count.second;
+      }
+      local[shard].clear();
+    }
+  }
+}
+
+void ParallelExtractLex::Count(const Line &line,
+                               std::unordered_map<std::string, uint32_t> &cache,
+                               std::vector<Counts> &local,
+                               size_t lineNum)
+{
+  std::vector<std::string> toks;
+  auto toIds = [&](const std::string &text, std::vector<uint32_t> &ids) {
+    toks.clear();
+    Split(text, toks, " ");
+    ids.clear();
+    for (const auto &tok : toks) {
+      auto it = cache.find(tok);
+      if (it == cache.end()) {
+        it = cache.emplace(tok, m_vocab.GetOrAdd(tok)).first;
+      }
+      ids.push_back(it->second);
+    }
+  };
+  auto add = [&](uint32_t source, uint32_t target) {
+    uint64_t key = Key(source, target);
+    ++local[ShardOf(key)][key];
+  };
+
+  std::vector<uint32_t> target, source;
+  toIds(line.target, target);
+  toIds(line.source, source);
+
+  std::vector<bool> sourceAligned(source.size(), false), targetAligned(target.size(), false);
+
+  toks.clear();
+  Split(line.align, toks, " ");
+  for (const auto &alignTok : toks) {
+    char *end;
+    size_t sourcePos = std::strtoul(alignTok.c_str(), &end, 10);
+    UTIL_THROW_IF2(*end != '-', "Broken alignment " << alignTok << " at line " << lineNum);
+    size_t targetPos = std::strtoul(end + 1, nullptr, 10);
+
+    if (sourcePos >= source.size()) {
+      std::cerr << "ERROR: alignment over source length. Alignment " << sourcePos << " at line " << lineNum << std::endl;
+      continue;
+    }
+    if (targetPos >= target.size()) {
+      std::cerr << "ERROR: alignment over target length. Alignment " << targetPos << " at line " << lineNum << std::endl;
+      continue;
+    }
+
+    sourceAligned[sourcePos] = true;
+    targetAligned[targetPos] = true;
+    add(source[sourcePos], target[targetPos]);
+  }
+
+  for (size_t pos = 0; pos < source.size(); ++pos) {
+    if (!sourceAligned[pos]) {
+      add(source[pos], m_null);
+    }
+  }
+  for (size_t pos = 0; pos < target.size(); ++pos) {
+    if (!targetAligned[pos]) {
+      add(m_null, target[pos]);
+    }
+  }
+}
+
+void ParallelExtractLex::Output(std::ostream &streamLexS2T, std::ostream &streamLexT2S) const
+{
+  const uint32_t bound = m_vocab.IdBound();
+
+  // words in alphabetical order, so the output does not depend on the
+  // order the threads met them in
+  std::vector<uint32_t> ids = m_vocab.Ids();
+  std::sort(ids.begin(), ids.end(), [&](uint32_t a, uint32_t b) { return m_vocab[a] < m_vocab[b]; });
+  std::vector<uint32_t> rank(bound);
+  for (uint32_t i = 0; i < ids.size(); ++i) {
+    rank[ids[i]] = i;
+  }
+
+  std::vector<Entry> entries;
+  std::vector<uint64_t> sourceTotals(bound), targetTotals(bound);
+  for (const auto &counts : m_counts) {
+    for (const auto &count : counts) {
+      Entry entry{uint32_t(count.first >> 32), uint32_t(count.first), count.second};
+      sourceTotals[entry.in] += entry.count;
+      targetTotals[entry.out] += entry.count;
+      entries.push_back(entry);
+    }
+  }
+
+  Output(entries, sourceTotals, rank, streamLexS2T);
+  for (auto &entry : entries) {
+    std::swap(entry.in, entry.out);
+  }
+  Output(entries, targetTotals, rank, streamLexT2S);
+}
+
+void ParallelExtractLex::Output(std::vector<Entry> &entries,
+                                const std::vector<uint64_t> &totals,
+                                const std::vector<uint32_t> &rank,
+                                std::ostream &outStream) const
+{
+  std::sort(entries.begin(), entries.end(), [&](const Entry &a, const Entry &b) {
+    if (a.in != b.in)
+      return rank[a.in] < rank[b.in];
+    if (a.count != b.count)
+      return a.count > b.count;
+    return rank[a.out] < rank[b.out];
+  });
+
+  size_t written = 0;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (i > 0 && entries[i].in != entries[i - 1].in) {
+      written = 0;
+    }
+    if (m_topN > 0 && written == m_topN) {
+      continue;
+    }
+    float prob = float(entries[i].count) / float(totals[entries[i].in]);
+    outStream << m_vocab[entries[i].out] << " " << m_vocab[entries[i].in] << " " << prob << "\n";
+    ++written;
+  }
+}
+
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace extract {
+
+// Word ids shared by all threads, split into shards with their own lock.
+// The id of a word encodes its shard, so ids can be handed out without
+// any global lock.
+class SharedVocab
+{
+public:
+  explicit SharedVocab(size_t numShards);
+
+  uint32_t GetOrAdd(const std::string &word);
+
+  // only once no thread adds words anymore
+  const std::string &operator[](uint32_t id) const;
+  std::vector<uint32_t> Ids() const;
+  // all ids are below this
+  uint32_t IdBound() const;
+
+private:
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<std::string, uint32_t> ids;
+    std::deque<std::string> words;
+  };
+
+  std::vector<Shard> m_shards;
+};
+
+// Same output as ExtractLex, with words as integer ids and the joint counts
+// of (source, target) pairs kept once in sharded hash tables. Both tables
+// are derived from these counts. Lines are read in blocks by the calling
+// thread and counted by numThreads workers. Each worker adds a block's
+// counts to the shared tables in one go, so a lock is taken once per
+// block and shard, not once per word.
+class ParallelExtractLex
+{
+public:
+  ParallelExtractLex(size_t numThreads, size_t topN);
+
+  // Counts the whole corpus, returns the number of sentence pairs
+  size_t Process(std::istream &streamTarget, std::istream &streamSource, std::istream &streamAlign);
+
+  // Writes "target source p(target|source)" and "source target
+  // p(source|target)" lines, only the topN most probable per source word
+  // respectively target word when topN > 0
+  void Output(std::ostream &streamLexS2T, std::ostream &streamLexT2S) const;
+
+private:
+  struct Line {
+    std::string target, source, align;
+  };
+  typedef std::vector<Line> Block;
+  typedef std::unordered_map<uint64_t, uint64_t> Counts;
+
+  struct Entry {
+    uint32_t in, out;
+    uint64_t count;
+  };
+
+  // Adds the counts of one sentence pair to local, one table per shard
+  void Count(const Line &line, std::unordered_map<std::string, uint32_t> &cache,
+             std::vector<Counts> &local, size_t lineNum);
+  void Work();
+  bool Pop(size_t &firstLine, Block &block);
+  void Push(size_t firstLine, Block &&block);
+
+  // entries sorted by rank of their in word, then by count
+  void Output(std::vector<Entry> &entries, const std::vector<uint64_t> &totals,
+              const std::vector<uint32_t> &rank, std::ostream &outStream) const;
+
+  const size_t m_numThreads;
+  const size_t m_topN;
+
+  SharedVocab m_vocab;
+  const uint32_t m_null;
+
+  std::vector<Counts> m_counts;
+  std::vector<std::mutex> m_countMutexes;
+
+  // blocks read but not yet counted, numbered to report lines
+  std::deque<std::pair<size_t, Block>> m_queue;
+  std::mutex m_queueMutex;
+  std::condition_variable m_notEmpty, m_notFull;
+  bool m_done;
+};
+
+}
@@ -1,17 +1,66 @@
 #include "base_best_hyps.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #include "god.h"
 
 using namespace std;
 
 namespace amunmt {
 
+namespace {
+
+float PruneMargin(const God &god) {
+  float margin = std::numeric_limits<float>::infinity();
+  float relative = god.GetOptions().pruneRelative;
+  if (relative > 0.0f) {
+    margin = std::min(margin, -std::log(relative));
+  }
+  float absolute = god.GetOptions().pruneAbsolute;
+  if (absolute > 0.0f) {
+    margin = std::min(margin, absolute);
+  }
+  return margin;
+}
+
+}
+
 BaseBestHyps::BaseBestHyps(const God &god)
 : god_(god),
-  forbidUNK_(!god.Get<bool>("allow-unk")),
-  isInputFiltered_(god.Get<std::vector<std::string>>("softmax-filter").size()),
-  returnAttentionWeights_(god.Get<bool>("return-alignment") || god.Get<bool>("return-soft-alignment") || god.Get<bool>("return-nematus-alignment")),
-  weights_(god.GetScorerWeights())
+  forbidUNK_(!god.GetOptions().allowUnk),
+  isInputFiltered_(god.GetOptions().filterSoftmax),
+  returnAttentionWeights_(god.GetOptions().ReturnAttentionWeights()),
+  weights_(god.GetScorerWeights()),
+  pruneMargin_(PruneMargin(god))
 {}
 
+void BaseBestHyps::Prune(std::vector<Beam>& beams, std::vector<unsigned>& beamSizes) const
+{
+  if (std::isinf(pruneMargin_)) {
+    return;
+  }
+
+  for (size_t batchId = 0; batchId < beams.size(); ++batchId) {
+    Beam& beam = beams[batchId];
+    if (beam.empty()) {
+      continue;
+    }
+
+    float best = std::numeric_limits<float>::lowest();
+    for (const HypothesisPtr& hyp : beam) {
+      best = std::max(best, hyp->GetCost());
+    }
+
+    float threshold = best - pruneMargin_;
+    auto end = std::remove_if(beam.begin(), beam.end(), [threshold](const HypothesisPtr& hyp) {
+      return hyp->GetCost() < threshold;
+    });
+    beamSizes[batchId] -= beam.end() - end;
+    beam.erase(end, beam.end());
+  }
+}
+
 }
 
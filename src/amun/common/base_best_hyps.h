@@ -20,15 +20,23 @@ class BaseBestHyps
         const Beam& prevHyps,
         const std::vector<ScorerPtr>& scorers,
         const Words& filterIndices,
+        HypothesisArena& arena,
         std::vector<Beam>& beams,
         std::vector<unsigned>& beamSizes) = 0;
 
   protected:
+    // Drops the hypotheses of each beam that fall further below the best one
+    // than prune-relative and prune-absolute allow, shrinking beamSizes to
+    // match. The best hypothesis of a beam always stays.
+    void Prune(std::vector<Beam>& beams, std::vector<unsigned>& beamSizes) const;
+
     const God &god_;
     const bool forbidUNK_;
     const bool isInputFiltered_;
     const bool returnAttentionWeights_;
     const std::map<std::string, float> weights_;
+    // largest cost difference to the best hypothesis kept by Prune
+    const float pruneMargin_;
 
 };
 
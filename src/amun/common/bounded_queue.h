@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include "common/logging.h"
+
+namespace amunmt {
+
+// Blocking FIFO between two pipeline stages. Push waits while the queue is
+// full, Pop waits while it is empty. After Close, Pop drains what is left
+// and then returns false. Keeps depth statistics to show which side of
+// the queue is the bottleneck.
+template <class T>
+class BoundedQueue {
+  public:
+    BoundedQueue(const std::string& name, size_t capacity)
+      : name_(name), capacity_(capacity ? capacity : 1), closed_(false),
+        pushes_(0), depthSum_(0), maxDepth_(0), fullWaits_(0), emptyWaits_(0)
+    {}
+
+    void Push(T item) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (queue_.size() >= capacity_) {
+        ++fullWaits_;
+        notFull_.wait(lock, [this] { return queue_.size() < capacity_; });
+      }
+      queue_.push_back(std::move(item));
+
+      ++pushes_;
+      depthSum_ += queue_.size();
+      maxDepth_ = std::max(maxDepth_, queue_.size());
+
+      lock.unlock();
+      notEmpty_.notify_one();
+    }
+
+    bool Pop(T& item) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (queue_.empty() && !closed_) {
+        ++emptyWaits_;
+        notEmpty_.wait(lock, [this] { return !queue_.empty() || closed_; });
+      }
+      if (queue_.empty()) {
+        return false;
+      }
+      item = std::move(queue_.front());
+      queue_.pop_front();
+
+      lock.unlock();
+      notFull_.notify_one();
+      return true;
+    }
+
+    // No more pushes, consumers finish once the queue is drained
+    void Close() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+      }
+      notEmpty_.notify_all();
+    }
+
+    bool Empty() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return queue_.empty();
+    }
+
+    // A queue that was often full has a slow consumer, one that was often
+    // empty a slow producer.
+    void LogStats() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      LOG(info)->info("Queue {}: {} items, capacity {}, mean depth {:.1f}, max depth {}, "
+                      "full {} times, empty {} times",
+                      name_, pushes_, capacity_, pushes_ ? (double)depthSum_ / pushes_ : 0.0,
+                      maxDepth_, fullWaits_, emptyWaits_);
+    }
+
+  private:
+    const std::string name_;
+    const size_t capacity_;
+
+    std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+    std::deque<T> queue_;
+    bool closed_;
+
+    size_t pushes_;
+    size_t depthSum_;
+    size_t maxDepth_;
+    size_t fullWaits_;
+    size_t emptyWaits_;
+
+    BoundedQueue(const BoundedQueue&) = delete;
+};
+
+}
@@ -113,6 +113,16 @@ void Validate(const YAML::Node& config) {
   amunmt_UTIL_THROW_IF2(config["maxi-batch"].as<int>() < config["mini-batch"].as<int>(),
                 "maxi-batch (" << config["maxi-batch"].as<int>()
                 << ") < mini-batch (" << config["mini-batch"].as<int>() << ")");
+
+  amunmt_UTIL_THROW_IF2(config["prune-relative"].as<float>() < 0.0f
+                        || config["prune-relative"].as<float>() >= 1.0f,
+                "prune-relative (" << config["prune-relative"].as<float>() << ") not in [0, 1)");
+
+  amunmt_UTIL_THROW_IF2(config["prune-absolute"].as<float>() < 0.0f,
+                "prune-absolute (" << config["prune-absolute"].as<float>() << ") < 0");
+
+  amunmt_UTIL_THROW_IF2(config["max-length-factor"].as<float>() <= 0.0f,
+                "max-length-factor (" << config["max-length-factor"].as<float>() << ") <= 0");
 }
 
 void OutputRec(const YAML::Node node, YAML::Emitter& out) {
@@ -212,6 +222,14 @@ void Config::AddOptions(unsigned argc, char** argv) {
      ("cpu-threads", po::value<unsigned>()->default_value(1),
       "Number of threads on the CPU.")
   #endif
+    ("softmax-filter-cache", po::value<unsigned>()->default_value(0),
+     "Number of shortlists each CPU scorer keeps the filtered output layer of, for batches with the same shortlist. 0=off")
+    ("cpu-scorer-threads", po::value<unsigned>()->default_value(1),
+     "Number of threads a CPU translation thread runs the scorers of an ensemble on concurrently. "
+     "Lowers latency at the cost of throughput.")
+    ("cpu-affinity", po::value<std::string>()->default_value("none"),
+     "Pin CPU threads to cores: none, compact (fill one NUMA node first) or scatter (NUMA nodes in turn). "
+     "With compact or scatter every NUMA node in use gets its own copy of the models.")
 #endif
 
 #ifdef HAS_FPGA
@@ -229,6 +247,12 @@ void Config::AddOptions(unsigned argc, char** argv) {
       "Number of sentences in maxi batch.")
     ("mini-batch-words", po::value<int>()->default_value(0),
       "Set mini-batch size based on words instead of sentences.")
+    ("translation-cache", po::value<unsigned>()->default_value(0),
+     "Cache translations of repeated source sentences in this many MB of memory. 0=off")
+    ("max-batch-delay", po::value<unsigned>()->default_value(10),
+      "amun-server: milliseconds a sentence may wait for a mini batch to fill up.")
+    ("port,p", po::value<unsigned>()->default_value(8080),
+      "amun-server: port to listen on.")
     ("use-fused-softmax", po::value<bool>()->default_value(true),
      "Use fused softmax/nth-element, if appropriate.")
     ("show-weights", po::value<bool>()->zero_tokens()->default_value(false),
@@ -267,6 +291,14 @@ void Config::AddOptions(unsigned argc, char** argv) {
      "Allow generation of UNK")
     ("n-best", po::value<bool>()->zero_tokens()->default_value(false),
      "Output n-best list with n = beam-size")
+    ("max-length-factor", po::value<float>()->default_value(3.0f),
+     "Maximum translation length as a multiple of the source length, per sentence")
+    ("no-early-stop", po::value<bool>()->zero_tokens()->default_value(false),
+     "Keep decoding a sentence after its best translation(s) can no longer change")
+    ("prune-relative", po::value<float>()->default_value(0.0f),
+     "Drop hypotheses less probable than this fraction of the best one in their beam. 0=off")
+    ("prune-absolute", po::value<float>()->default_value(0.0f),
+     "Drop hypotheses whose cost is more than this below the best one in their beam. 0=off")
   ;
 
   po::options_description configuration("Configuration meta options");
@@ -321,9 +353,16 @@ void Config::AddOptions(unsigned argc, char** argv) {
   SET_OPTION("allow-unk", bool);
   SET_OPTION("no-debpe", bool);
   SET_OPTION("beam-size", unsigned);
+  SET_OPTION("max-length-factor", float);
+  SET_OPTION("no-early-stop", bool);
+  SET_OPTION("prune-relative", float);
+  SET_OPTION("prune-absolute", float);
   SET_OPTION("mini-batch", unsigned);
   SET_OPTION("maxi-batch", unsigned);
   SET_OPTION("mini-batch-words", int);
+  SET_OPTION("max-batch-delay", unsigned);
+  SET_OPTION("translation-cache", unsigned);
+  SET_OPTION("port", unsigned);
   SET_OPTION("max-length", unsigned);
   SET_OPTION("use-fused-softmax", bool);
 #ifdef CUDA
@@ -333,6 +372,9 @@ void Config::AddOptions(unsigned argc, char** argv) {
 #endif
 #ifdef HAS_CPU
   SET_OPTION("cpu-threads", unsigned);
+  SET_OPTION("cpu-scorer-threads", unsigned);
+  SET_OPTION("softmax-filter-cache", unsigned);
+  SET_OPTION("cpu-affinity", std::string);
 #endif
 #ifdef HAS_FPGA
   SET_OPTION("fpga-threads", unsigned);
@@ -0,0 +1,116 @@
+#include "common/cpu_topology.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+
+#include "common/exception.h"
+#include "common/utils.h"
+
+namespace amunmt {
+
+namespace {
+
+// "0-3,8,10-11" as in the cpulist files of sysfs
+std::vector<int> ParseCPUList(const std::string& list) {
+  std::vector<int> cpus;
+  std::vector<std::string> ranges;
+  Split(list, ranges, ",");
+  for (const auto& range : ranges) {
+    size_t dash = range.find('-');
+    int first = std::atoi(range.c_str());
+    int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+}
+
+CPUTopology::CPUTopology(const std::string& sysfsNodes) {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  bool haveMask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+  auto usable = [&](int cpu) {
+    return !haveMask || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed));
+  };
+
+  std::string online;
+  std::ifstream onlineFile(sysfsNodes + "/online");
+  if (std::getline(onlineFile, online)) {
+    for (int node : ParseCPUList(online)) {
+      std::ifstream cpuFile(sysfsNodes + "/node" + std::to_string(node) + "/cpulist");
+      std::string list;
+      std::getline(cpuFile, list);
+      Trim(list);
+
+      if (nodes_.size() <= unsigned(node)) {
+        nodes_.resize(node + 1);
+      }
+      for (int cpu : ParseCPUList(list)) {
+        if (usable(cpu)) {
+          nodes_[node].push_back(cpu);
+        }
+      }
+    }
+  }
+
+  bool any = false;
+  for (const auto& cpus : nodes_) {
+    any = any || !cpus.empty();
+  }
+  if (!any) {
+    nodes_.assign(1, std::vector<int>());
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (haveMask ? CPU_ISSET(cpu, &allowed) : cpu == 0) {
+        nodes_[0].push_back(cpu);
+      }
+    }
+  }
+}
+
+std::vector<CPUPlacement> CPUTopology::Place(unsigned numThreads, const std::string& policy) const {
+  amunmt_UTIL_THROW_IF2(policy != "compact" && policy != "scatter",
+                        "Unknown cpu-affinity " << policy << ", use none, compact or scatter");
+
+  std::vector<CPUPlacement> order;
+  if (policy == "compact") {
+    for (unsigned node = 0; node < nodes_.size(); ++node) {
+      for (int cpu : nodes_[node]) {
+        order.push_back(CPUPlacement{node, cpu});
+      }
+    }
+  } else {
+    for (size_t i = 0; ; ++i) {
+      size_t before = order.size();
+      for (unsigned node = 0; node < nodes_.size(); ++node) {
+        if (i < nodes_[node].size()) {
+          order.push_back(CPUPlacement{node, nodes_[node][i]});
+        }
+      }
+      if (order.size() == before) {
+        break;
+      }
+    }
+  }
+
+  std::vector<CPUPlacement> placements;
+  for (unsigned i = 0; i < numThreads; ++i) {
+    placements.push_back(order[i % order.size()]);
+  }
+  return placements;
+}
+
+bool PinCurrentThread(const std::vector<int>& cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    CPU_SET(cpu, &set);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+}
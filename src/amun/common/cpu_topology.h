@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace amunmt {
+
+struct CPUPlacement {
+  unsigned numaNode;
+  int cpu;
+};
+
+// The CPUs this process may run on, grouped by NUMA node as listed in
+// sysfs. Without NUMA information all of them form node 0.
+class CPUTopology {
+  public:
+    CPUTopology(const std::string& sysfsNodes = "/sys/devices/system/node");
+
+    unsigned NumNodes() const {
+      return nodes_.size();
+    }
+
+    // empty for nodes without usable CPUs
+    const std::vector<int>& NodeCPUs(unsigned node) const {
+      return nodes_[node];
+    }
+
+    // One CPU for each of numThreads workers. "compact" fills the CPUs of
+    // one node before the next, "scatter" takes the nodes in turn. CPUs are
+    // reused when there are more workers than CPUs.
+    std::vector<CPUPlacement> Place(unsigned numThreads, const std::string& policy) const;
+
+  private:
+    std::vector<std::vector<int>> nodes_;
+};
+
+// Restricts the calling thread to cpus, false if that failed
+bool PinCurrentThread(const std::vector<int>& cpus);
+
+}
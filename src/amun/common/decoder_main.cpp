@@ -2,8 +2,11 @@
 #include <iostream>
 #include <string>
 #include <memory>
+#include <thread>
+#include <utility>
 #include <boost/timer/timer.hpp>
 
+#include "common/bounded_queue.h"
 #include "common/god.h"
 #include "common/logging.h"
 #include "common/search.h"
@@ -27,49 +30,79 @@ int main(int argc, char* argv[])
   boost::timer::cpu_timer timer;
 
 
-  unsigned miniSize = (god.Get<unsigned>("cpu-threads") == 0) ? god.Get<unsigned>("mini-batch") : 1;
-  unsigned maxiSize = (god.Get<unsigned>("cpu-threads") == 0) ? god.Get<unsigned>("maxi-batch") : 1;
-  int miniWords = god.Get<int>("mini-batch-words");
+  unsigned miniSize = god.GetOptions().miniBatch;
+  unsigned maxiSize = god.GetOptions().maxiBatch;
+  int miniWords = god.GetOptions().miniBatchWords;
 
-  LOG(info)->info("Reading input");
-
-  SentencesPtr maxiBatch(new Sentences());
-
-  std::string line;
-  unsigned lineNum = 0;
+  // Reading, tokenization, batching, translation and output run
+  // concurrently: the main thread reads lines, one thread turns them into
+  // sentences, one groups those into mini batches for the thread pool, and
+  // the output collector prints finished translations in order. The queues
+  // between stages hold two maxi batches, so the next one is prepared while
+  // the current one is translated.
+  BoundedQueue<std::pair<unsigned, std::string>> lines("input", 2 * maxiSize);
+  BoundedQueue<SentencePtr> sentences("sentences", 2 * maxiSize);
 
-  while (std::getline(god.GetInputStream(), line)) {
-    maxiBatch->push_back(SentencePtr(new Sentence(god, lineNum++, line)));
+  std::thread tokenizer([&god, &lines, &sentences] {
+    std::pair<unsigned, std::string> line;
+    while (lines.Pop(line)) {
+      sentences.Push(SentencePtr(new Sentence(god, line.first, line.second)));
+    }
+    sentences.Close();
+  });
+
+  std::thread batcher([&god, &sentences, miniSize, maxiSize, miniWords] {
+    SentencesPtr maxiBatch(new Sentences());
+    SentencePtr sentence;
+    bool more = true;
+    while (more) {
+      more = sentences.Pop(sentence);
+      if (more) {
+        // repeated sentences skip batching and translation altogether
+        std::string output;
+        TranslationCache* cache = god.GetTranslationCache();
+        if (cache && cache->Get(*sentence, output)) {
+          god.GetOutputCollector().Write(sentence->GetLineNum(), output);
+        } else {
+          maxiBatch->push_back(sentence);
+        }
+      }
 
-    if (maxiBatch->size() >= maxiSize) {
+      // last batch may be smaller
+      if (maxiBatch->size() >= maxiSize || (!more && maxiBatch->size())) {
+        maxiBatch->SortByLength();
+        while (maxiBatch->size()) {
+          SentencesPtr miniBatch = maxiBatch->NextMiniBatch(miniSize, miniWords);
+          //cerr << "miniBatch=" << miniBatch->size() << " maxiBatch=" << maxiBatch->size() << endl;
 
-      maxiBatch->SortByLength();
-      while (maxiBatch->size()) {
-        SentencesPtr miniBatch = maxiBatch->NextMiniBatch(miniSize, miniWords);
-        //cerr << "miniBatch=" << miniBatch->size() << " maxiBatch=" << maxiBatch->size() << endl;
+          god.GetThreadPool().post(
+              [&god,miniBatch]{ TranslationTaskAndOutput(god, miniBatch); }
+              );
+        }
 
-        god.GetThreadPool().enqueue(
-            [&god,miniBatch]{ return TranslationTaskAndOutput(god, miniBatch); }
-            );
+        maxiBatch.reset(new Sentences());
       }
-
-      maxiBatch.reset(new Sentences());
     }
+  });
 
-  }
+  LOG(info)->info("Reading input");
 
-  // last batch
-  if (maxiBatch->size()) {
-    maxiBatch->SortByLength();
-    while (maxiBatch->size()) {
-      SentencesPtr miniBatch = maxiBatch->NextMiniBatch(miniSize, miniWords);
-      god.GetThreadPool().enqueue(
-          [&god,miniBatch]{ return TranslationTaskAndOutput(god, miniBatch); }
-          );
-    }
+  std::string line;
+  unsigned lineNum = 0;
+
+  while (std::getline(god.GetInputStream(), line)) {
+    lines.Push(std::make_pair(lineNum++, line));
   }
+  lines.Close();
 
+  tokenizer.join();
+  batcher.join();
+
+  // waits for the translations and their output
   god.Cleanup();
+
+  lines.LogStats();
+  sentences.LogStats();
   LOG(info)->info("Total time: {}", timer.format());
 
   return 0;
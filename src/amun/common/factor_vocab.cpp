@@ -1,4 +1,5 @@
 #include "common/factor_vocab.h"
+#include "common/utils.h"
 
 namespace amunmt {
 
@@ -26,7 +27,23 @@ namespace amunmt {
     std::transform(lineFactors.begin(), lineFactors.end(), words.begin(),
                    [&](const std::vector<std::string>& factors) {return (*this)[factors];});
     if(addEOS)
-      words.push_back(FactWord(words.back().size(), EOS_ID));
+      words.push_back(FactWord(words.empty() ? vocabs_.size() : words.back().size(), EOS_ID));
+    return words;
+  }
+
+  FactWords FactorVocab::operator()(const std::vector<boost::string_view>& tokens, bool addEOS) const {
+    FactWords words(tokens.size());
+    std::vector<boost::string_view> factors;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      factors.clear();
+      Split(tokens[i], factors, '|');
+      words[i].resize(factors.size());
+      for (size_t j = 0; j < factors.size(); ++j) {
+        words[i][j] = (*vocabs_[j])[factors[j]];
+      }
+    }
+    if(addEOS)
+      words.push_back(FactWord(words.empty() ? vocabs_.size() : words.back().size(), EOS_ID));
     return words;
   }
 
@@ -16,6 +16,8 @@ class FactorVocab {
     FactWord operator[](const std::vector<std::string>& factors) const;
     FactWords operator()(const std::vector<std::vector<std::string>>& lineFactors,
                                      bool addEOS=true) const;
+    // tokens with their factors separated by '|'
+    FactWords operator()(const std::vector<boost::string_view>& tokens, bool addEOS=true) const;
     Vocab& GetVocab(size_t factorIdx) const;
   private:
     typedef std::unique_ptr<Vocab> VocabPtr;
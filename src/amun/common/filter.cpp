@@ -8,29 +8,137 @@
 #include <set>
 #include <cmath>
 #include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "common/god.h"
 #include "common/vocab.h"
 #include "common/utils.h"
 #include "common/types.h"
+#include "common/exception.h"
 
 using namespace std;
 
 namespace amunmt {
 
-Filter::Filter(const unsigned numFirstWords) : numFirstWords_(numFirstWords) {}
+namespace {
+
+const char LEX_MAGIC[8] = {'A', 'M', 'U', 'N', 'L', 'E', 'X', '1'};
+
+template <typename T>
+void Write(std::ostream& out, const T& val) {
+  out.write(reinterpret_cast<const char*>(&val), sizeof(T));
+}
+
+}
+
+Filter::Filter(const unsigned numFirstWords)
+  : numFirstWords_(numFirstWords),
+    numSource_(0),
+    offsets_(nullptr),
+    targets_(nullptr)
+{}
 
 Filter::Filter(const Vocab& srcVocab,
                const Vocab& trgVocab,
                const std::string& path,
                const unsigned numFirstWords,
                const unsigned maxNumTranslation)
-  : numFirstWords_(numFirstWords),
-    mapper_(ParseAlignmentFile(srcVocab,
-                               trgVocab,
-                               path,
-                               maxNumTranslation,
-                               numFirstWords)) {}
+  : Filter(numFirstWords)
+{
+  if (IsBinary(path)) {
+    Map(path, srcVocab, trgVocab);
+    if (numFirstWords_ != numFirstWords) {
+      LOG(info)->info("Filter: using the {} first words the binary table was made for", numFirstWords_);
+    }
+    return;
+  }
+
+  std::vector<Words> mapper = ParseAlignmentFile(srcVocab, trgVocab, path,
+                                                 maxNumTranslation, numFirstWords);
+  offsetStore_.reserve(mapper.size() + 1);
+  offsetStore_.push_back(0);
+  for (const auto& words : mapper) {
+    targetStore_.insert(targetStore_.end(), words.begin(), words.end());
+    offsetStore_.push_back(targetStore_.size());
+  }
+  numSource_ = mapper.size();
+  offsets_ = offsetStore_.data();
+  targets_ = targetStore_.data();
+}
+
+bool Filter::IsBinary(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  char magic[sizeof(LEX_MAGIC)];
+  return in.read(magic, sizeof(magic))
+      && std::memcmp(magic, LEX_MAGIC, sizeof(LEX_MAGIC)) == 0;
+}
+
+void Filter::WriteBinary(const std::string& path,
+                         const std::vector<Words>& mapper,
+                         unsigned trgVocabSize,
+                         unsigned numFirstWords)
+{
+  std::ofstream out(path, std::ios::binary);
+  amunmt_UTIL_THROW_IF2(!out, "Cannot write " << path);
+
+  // header: magic, source and target vocabulary sizes, first words;
+  // all fields are 64 bit so the offsets that follow stay aligned
+  out.write(LEX_MAGIC, sizeof(LEX_MAGIC));
+  Write<uint64_t>(out, mapper.size());
+  Write<uint64_t>(out, trgVocabSize);
+  Write<uint64_t>(out, numFirstWords);
+
+  uint64_t offset = 0;
+  Write<uint64_t>(out, offset);
+  for (const auto& words : mapper) {
+    offset += words.size();
+    Write<uint64_t>(out, offset);
+  }
+  for (const auto& words : mapper) {
+    out.write(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(Word));
+  }
+  amunmt_UTIL_THROW_IF2(!out, "Cannot write " << path);
+}
+
+void Filter::Map(const std::string& path, const Vocab& srcVocab, const Vocab& trgVocab) {
+  int fd = open(path.c_str(), O_RDONLY);
+  amunmt_UTIL_THROW_IF2(fd < 0, "Cannot open " << path);
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    amunmt_UTIL_THROW2("Cannot stat " << path);
+  }
+  size_t size = st.st_size;
+
+  void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  amunmt_UTIL_THROW_IF2(addr == MAP_FAILED, "Cannot memory-map " << path);
+  mapping_.reset(addr, [size](const void* p) { munmap(const_cast<void*>(p), size); });
+
+  const char* begin = static_cast<const char*>(addr);
+  const uint64_t* header = reinterpret_cast<const uint64_t*>(begin + sizeof(LEX_MAGIC));
+  const size_t headerBytes = sizeof(LEX_MAGIC) + 3 * sizeof(uint64_t);
+  amunmt_UTIL_THROW_IF2(size < headerBytes, "Truncated lexical table " << path);
+
+  numSource_ = header[0];
+  amunmt_UTIL_THROW_IF2(numSource_ != srcVocab.size() || header[1] != trgVocab.size(),
+                        "Lexical table " << path << " was made for vocabularies of "
+                        << header[0] << " and " << header[1] << " words, not "
+                        << srcVocab.size() << " and " << trgVocab.size());
+  numFirstWords_ = header[2];
+
+  offsets_ = header + 3;
+  const size_t offsetBytes = (numSource_ + 1) * sizeof(uint64_t);
+  amunmt_UTIL_THROW_IF2(size < headerBytes + offsetBytes
+                        || size != headerBytes + offsetBytes + offsets_[numSource_] * sizeof(Word),
+                        "Corrupt lexical table " << path);
+  targets_ = reinterpret_cast<const Word*>(begin + headerBytes + offsetBytes);
+}
 
 std::vector<Words> Filter::ParseAlignmentFile(const Vocab& srcVocab,
                                               const Vocab& trgVocab,
@@ -1,9 +1,11 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <memory>
-#include <unordered_set>
-#include <set>
+#include <algorithm>
+#include <numeric>
+#include <vector>
 
 #include "common/types.h"
 
@@ -21,23 +23,28 @@ class Filter {
            const unsigned numFirstWords=10000,
            const unsigned maxNumTranslation=1000);
 
+    // Sorted ids of the first numFirstWords words plus the translations of
+    // srcWords, all below maxVocabSize
     template<class T>
     Words GetFilteredVocab(const T& srcWords, const unsigned maxVocabSize) const {
-      std::set<Word> filtered;
-
-      for(unsigned i = 0; i < std::min(numFirstWords_, maxVocabSize); ++i) {
-        filtered.insert(i);
-      }
+      const unsigned firstWords = std::min(numFirstWords_, maxVocabSize);
+      Words output(firstWords);
+      std::iota(output.begin(), output.end(), 0);
 
+      std::vector<bool> seen(maxVocabSize, false);
       for (const auto& srcWord : srcWords) {
-        for (const auto& trgWord : mapper_[srcWord]) {
-          if (trgWord < maxVocabSize) {
-            filtered.insert(trgWord);
+        if (srcWord >= numSource_) {
+          continue;
+        }
+        for (uint64_t i = offsets_[srcWord]; i < offsets_[srcWord + 1]; ++i) {
+          const Word trgWord = targets_[i];
+          if (trgWord >= firstWords && trgWord < maxVocabSize && !seen[trgWord]) {
+            seen[trgWord] = true;
+            output.push_back(trgWord);
           }
         }
       }
-
-      Words output(filtered.begin(), filtered.end());
+      std::sort(output.begin() + firstWords, output.end());
 
       return output;
     }
@@ -52,9 +59,34 @@ class Filter {
                                                  const unsigned maxNumTranslation,
                                                  const unsigned numNFirst);
 
+    // Whether path is a lexical table written by WriteBinary
+    static bool IsBinary(const std::string& path);
+
+    // Saves the translations of every source word in the format the
+    // constructor memory-maps: a header, one offset per source word and
+    // the target ids, best first
+    static void WriteBinary(const std::string& path,
+                            const std::vector<Words>& mapper,
+                            unsigned trgVocabSize,
+                            unsigned numFirstWords);
+
   private:
+    void Map(const std::string& path, const Vocab& srcVocab, const Vocab& trgVocab);
+
     unsigned numFirstWords_;
-    const std::vector<Words> mapper_;
+
+    // the translations of source word i are targets_[offsets_[i]] up to
+    // targets_[offsets_[i + 1]], both point into the mapped file or into
+    // the stores below
+    size_t numSource_;
+    const uint64_t* offsets_;
+    const Word* targets_;
+
+    std::vector<uint64_t> offsetStore_;
+    Words targetStore_;
+    std::shared_ptr<const void> mapping_;
+
+    Filter(const Filter&) = delete;
 };
 
 typedef std::unique_ptr<Filter> FilterPtr;
@@ -9,6 +9,7 @@
 #include "common/vocab.h"
 #include "common/factor_vocab.h"
 #include "common/config.h"
+#include "common/cpu_topology.h"
 #include "common/threadpool.h"
 #include "common/file_stream.h"
 #include "common/filter.h"
@@ -52,6 +53,7 @@ God& God::Init(const std::string& options) {
 God& God::Init(int argc, char** argv) {
 
   config_.AddOptions(argc, argv);
+  options_ = Options(config_);
   info_ = spdlog::stderr_logger_mt("info");
   info_->set_pattern("[%c] (%L) %v");
   set_loglevel(*info_, config_.Get<string>("log-info"));
@@ -88,15 +90,33 @@ God& God::Init(int argc, char** argv) {
     exit(0);
   }
 
+#ifdef HAS_CPU
+  std::string affinity = Get<std::string>("cpu-affinity");
+  if (affinity != "none") {
+    CPUTopology topology;
+    cpuPlacements_ = topology.Place(Get<unsigned>("cpu-threads"), affinity);
+    unsigned numNodes = 0;
+    for (const auto& placement : cpuPlacements_) {
+      if (numaNodeCPUs_.size() <= placement.numaNode) {
+        numaNodeCPUs_.resize(placement.numaNode + 1);
+      }
+      if (numaNodeCPUs_[placement.numaNode].empty()) {
+        numaNodeCPUs_[placement.numaNode] = topology.NodeCPUs(placement.numaNode);
+        ++numNodes;
+      }
+    }
+    LOG(info)->info("Placing {} CPU threads on {} of {} NUMA nodes", cpuPlacements_.size(),
+                    numNodes, topology.NumNodes());
+  }
+#endif
+
   LoadScorers();
   LoadFiltering();
 
-  returnNBestList_ = Get<bool>("n-best");
-
   if (Get<bool>("use-fused-softmax")) {
     useFusedSoftmax_ = true;
-    if (gpuLoaders_.size() != 1 || // more than 1 scorer
-        God::Get<unsigned>("beam-size") > 11 // beam size affect shared mem alloc in gLogSoftMax()
+    if (gpuLoaders_.size() + cpuLoaders_.size() != 1 || fpgaLoaders_.size() || // exactly 1 GPU or CPU scorer
+        (gpuLoaders_.size() && options_.beamSize > 11) // beam size affect shared mem alloc in gLogSoftMax()
         ) {
       useFusedSoftmax_ = false;
     }
@@ -122,6 +142,15 @@ God& God::Init(int argc, char** argv) {
 
   LoadPrePostProcessing();
 
+  if (Get<unsigned>("translation-cache")) {
+    if (Get<bool>("return-nematus-alignment")) {
+      // its output repeats the line number in every alignment line
+      LOG(info)->info("No translation cache with return-nematus-alignment");
+    } else {
+      translationCache_.reset(new TranslationCache(*this, Get<unsigned>("translation-cache") * 1048576ul));
+    }
+  }
+
   unsigned totalThreads = GetTotalThreads();
   LOG(info)->info("Total number of threads: {}", totalThreads);
   amunmt_UTIL_THROW_IF2(totalThreads == 0, "Total number of threads is 0");
@@ -133,7 +162,16 @@ God& God::Init(int argc, char** argv) {
 
 void God::Cleanup()
 {
-  pool_.reset();
+  if (pool_) {
+    pool_->stop();
+    pool_->logStats("translation");
+    pool_.reset();
+  }
+  outputCollector_.Close();
+  if (translationCache_) {
+    translationCache_->LogStats();
+    translationCache_.reset();
+  }
   cpuLoaders_.clear();
   gpuLoaders_.clear();
   fpgaLoaders_.clear();
@@ -303,26 +341,24 @@ const std::map<std::string, float>& God::GetScorerWeights() const {
   return weights_;
 }
 
-std::vector<std::vector<std::string>> God::Preprocess (
-  unsigned i, const std::vector<std::vector<std::string>>& input
-) const {
-  std::vector<std::vector<std::string>> processed = input;
+bool God::HasPreprocessors(unsigned i) const {
+  return preprocessors_.size() >= i + 1 && !preprocessors_[i].empty();
+}
+
+void God::Preprocess(unsigned i, std::vector<std::vector<std::string>>& words) const {
   if (preprocessors_.size() >= i + 1) {
     for (const auto& processor : preprocessors_[i]) {
-      processed = processor->Preprocess(processed);
+      processor->Preprocess(words);
     }
   }
-  return processed;
 }
 
-std::vector<std::string> God::Preprocess(unsigned i, const std::vector<std::string>& input) const {
-  std::vector<std::string> processed = input;
+void God::Preprocess(unsigned i, std::vector<std::string>& words) const {
   if (preprocessors_.size() >= i + 1) {
     for (const auto& processor : preprocessors_[i]) {
-      processed = processor->Preprocess(processed);
+      processor->Preprocess(words);
     }
   }
-  return processed;
 }
 
 std::vector<std::string> God::Postprocess(const std::vector<std::string>& input) const {
@@ -363,6 +399,10 @@ DeviceInfo God::GetNextDevice() const
   if (threadIncr_ < cpuThreads) {
     ret.deviceType = CPUDevice;
     ret.threadInd = threadIncr_;
+    if (threadIncr_ < cpuPlacements_.size()) {
+      ret.numaNode = cpuPlacements_[threadIncr_].numaNode;
+      ret.cpu = cpuPlacements_[threadIncr_].cpu;
+    }
   }
   else if (threadIncr_ < cpuThreads + totGPUThreads) {
     ret.deviceType = GPUDevice;
@@ -6,6 +6,8 @@
 
 #include "common/processor/processor.h"
 #include "common/config.h"
+#include "common/cpu_topology.h"
+#include "common/options.h"
 #include "common/loader.h"
 #include "common/logging.h"
 #include "common/scorer.h"
@@ -15,6 +17,7 @@
 #include "common/vocab.h"
 #include "common/factor_vocab.h"
 #include "common/threadpool.h"
+#include "common/translation_cache.h"
 #include "common/file_stream.h"
 #include "common/filter.h"
 #include "common/processor/bpe.h"
@@ -52,6 +55,9 @@ class God {
       return config_.Get(key);
     }
 
+    const Options& GetOptions() const
+    { return options_; }
+
     Vocab& GetSourceVocab(unsigned tab = 0, unsigned factor = 0) const;
     FactorVocab& GetSourceVocabs(unsigned tab=0) const;
     Vocab& GetTargetVocab() const;
@@ -59,6 +65,10 @@ class God {
     std::istream& GetInputStream() const;
     OutputCollector& GetOutputCollector() const;
 
+    // nullptr unless translation-cache is set
+    TranslationCache* GetTranslationCache() const
+    { return translationCache_.get(); }
+
     std::shared_ptr<const Filter> GetFilter() const;
 
     BaseBestHypsPtr GetBestHyps(const DeviceInfo &deviceInfo) const;
@@ -67,15 +77,20 @@ class God {
     std::vector<std::string> GetScorerNames() const;
     const std::map<std::string, float>& GetScorerWeights() const;
 
-    std::vector<std::vector<std::string>> Preprocess
-      (unsigned i, const std::vector<std::vector<std::string>>& input) const;
-    std::vector<std::string> Preprocess(unsigned i, const std::vector<std::string>& input) const;
+    bool HasPreprocessors(unsigned i) const;
+    void Preprocess(unsigned i, std::vector<std::vector<std::string>>& words) const;
+    void Preprocess(unsigned i, std::vector<std::string>& words) const;
     std::vector<std::string> Postprocess(const std::vector<std::string>& input) const;
 
 
     void LoadWeights(const std::string& path);
 
     DeviceInfo GetNextDevice() const;
+
+    // The CPUs of every NUMA node that CPU threads are placed on, by node,
+    // empty for the others. Empty unless cpu-affinity is set.
+    const std::vector<std::vector<int>>& GetNumaNodeCPUs() const
+    { return numaNodeCPUs_; }
     Search &GetSearch() const;
 
     unsigned GetTotalThreads() const;
@@ -83,7 +98,7 @@ class God {
     { return *pool_; }
 
     bool ReturnNBestList() const
-    { return returnNBestList_; }
+    { return options_.nBest; }
 
     bool UseFusedSoftmax() const
     { return useFusedSoftmax_; }
@@ -98,6 +113,7 @@ class God {
 
 
     Config config_;
+    Options options_;
 
     // a list of source side factor vocabularies for each of the tabs
     mutable std::vector<FactorVocab> sourceVocabs_;
@@ -122,8 +138,10 @@ class God {
     mutable boost::shared_mutex accessLock_;
 
     std::unique_ptr<ThreadPool> pool_;
+    std::vector<CPUPlacement> cpuPlacements_;
+    std::vector<std::vector<int>> numaNodeCPUs_;
+    std::unique_ptr<TranslationCache> translationCache_;
 
-    bool returnNBestList_;
     bool useFusedSoftmax_, useTensorCores_;
 };
 
@@ -5,16 +5,27 @@ using namespace std;
 
 namespace amunmt {
 
-Histories::Histories(const Sentences& sentences, bool normalizeScore)
- : coll_(sentences.size())
+Histories::Histories(const Sentences& sentences, bool normalizeScore, float maxLengthFactor)
+ : arena_(new HypothesisArena()),
+   coll_(sentences.size())
 {
   for (unsigned i = 0; i < sentences.size(); ++i) {
     const Sentence &sentence = sentences.Get(i);
-    History *history = new History(sentence, normalizeScore, 3 * sentence.size());
+    unsigned maxLength = std::max(1u, (unsigned)(maxLengthFactor * sentence.size()));
+    History *history = new History(sentence, normalizeScore, maxLength, arena_);
     coll_[i].reset(history);
   }
 }
 
+unsigned Histories::GetMaxLength() const
+{
+  unsigned ret = 0;
+  for (const std::shared_ptr<History>& history : coll_) {
+    ret = std::max(ret, history->GetMaxLength());
+  }
+  return ret;
+}
+
 
 class LineNumOrderer
 {
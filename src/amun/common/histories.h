@@ -6,7 +6,7 @@ namespace amunmt {
 class Histories {
   public:
     Histories() {} // for all histories in translation task
-    Histories(const Sentences& sentences, bool normalizeScore);
+    Histories(const Sentences& sentences, bool normalizeScore, float maxLengthFactor);
 
     std::shared_ptr<History> at(unsigned id) const {
       return coll_.at(id);
@@ -24,6 +24,9 @@ class Histories {
       }
     }
 
+    // longest translation any of the sentences may get
+    unsigned GetMaxLength() const;
+
     void SortByLineNum();
     void Append(const Histories &other);
 
@@ -35,11 +38,17 @@ class Histories {
       return beam;
     }
 
+    // where the hypotheses of this translation are allocated
+    HypothesisArena& GetArena() {
+      return *arena_;
+    }
+
     void SetActive(bool active);
     void SetActive(unsigned id, bool active);
     unsigned NumActive() const;
 
   protected:
+    HypothesisArenaPtr arena_;
     std::vector<std::shared_ptr<History>> coll_;
     Histories(const Histories &) = delete;
 };
@@ -1,16 +1,21 @@
 #include "history.h"
+
+#include <limits>
+
 #include "sentences.h"
 
 using namespace std;
 
 namespace amunmt {
 
-History::History(const Sentence &sentence, bool normalizeScore, unsigned maxLength)
-  : normalize_(normalizeScore),
+History::History(const Sentence &sentence, bool normalizeScore, unsigned maxLength,
+                 HypothesisArenaPtr arena)
+  : arena_(arena),
+    normalize_(normalizeScore),
     lineNo_(sentence.GetLineNum()),
    maxLength_(maxLength)
 {
-  Add({HypothesisPtr(new Hypothesis(sentence))});
+  Add({arena_->New(sentence)});
 }
 
 void History::Add(const Beam& beam) {
@@ -48,6 +53,32 @@ NBestList History::NBest(unsigned n) const
   return nbest;
 }
 
+bool History::IsDecided(const Beam& beam, unsigned n) const
+{
+  if (topHyps_.size() < n) {
+    return false;
+  }
+
+  // a normalized cost can at most rise to cost / maxLength_, by appending
+  // words for free up to the length limit
+  float bound = std::numeric_limits<float>::lowest();
+  for (const HypothesisPtr& hyp : beam) {
+    if (hyp->GetWord() != EOS_ID) {
+      bound = std::max(bound, normalize_ ? hyp->GetCost() / maxLength_ : hyp->GetCost());
+    }
+  }
+
+  if (n == 1) {
+    return topHyps_.top().cost > bound;
+  }
+
+  auto topHypsCopy = topHyps_;
+  for (unsigned i = 1; i < n; ++i) {
+    topHypsCopy.pop();
+  }
+  return topHypsCopy.top().cost > bound;
+}
+
 void History::SetActive(bool active)
 {
   active_ = active;
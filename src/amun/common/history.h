@@ -25,7 +25,8 @@ class History {
     History(const History&) = delete;
 
   public:
-    History(const Sentence &sentence, bool normalizeScore, unsigned maxLength);
+    History(const Sentence &sentence, bool normalizeScore, unsigned maxLength,
+            HypothesisArenaPtr arena);
 
     void Add(const Beam& beam);
 
@@ -46,10 +47,20 @@ class History {
     unsigned GetLineNum() const
     { return lineNo_; }
 
+    unsigned GetMaxLength() const
+    { return maxLength_; }
+
+    // True when the n best finished translations already beat anything the
+    // unfinished hypotheses of beam can still reach. Relies on costs never
+    // increasing as words are added.
+    bool IsDecided(const Beam& beam, unsigned n) const;
+
     void SetActive(bool active);
     bool GetActive() const;
 
   private:
+    // keeps the hypotheses alive as long as the history
+    HypothesisArenaPtr arena_;
     std::vector<Beam> history_;
     std::priority_queue<HypothesisCoord> topHyps_;
     bool normalize_;
@@ -1,6 +1,9 @@
 #pragma once
 #include <memory>
 #include <cassert>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include "common/types.h"
 #include "common/soft_alignment.h"
 
@@ -9,7 +12,9 @@ namespace amunmt {
 class Hypothesis;
 class Sentence;
 
-typedef std::shared_ptr<Hypothesis> HypothesisPtr;
+// Hypotheses live in the HypothesisArena of their translation and are
+// referred to by plain pointers
+typedef Hypothesis* HypothesisPtr;
 
 class Hypothesis {
   public:
@@ -30,13 +35,13 @@ class Hypothesis {
     {}
 
     Hypothesis(const HypothesisPtr prevHyp, unsigned word, unsigned prevIndex, float cost,
-               std::vector<SoftAlignmentPtr> alignment)
+               std::vector<SoftAlignmentPtr>&& alignment)
     : sentence_(prevHyp->sentence_),
       prevHyp_(prevHyp),
       prevIndex_(prevIndex),
       word_(word),
       cost_(cost),
-      alignments_(alignment)
+      alignments_(std::move(alignment))
     {}
 
     const HypothesisPtr GetPrevHyp() const {
@@ -79,11 +84,56 @@ class Hypothesis {
     std::vector<float> costBreakdown_;
 };
 
-typedef std::pair<Words, HypothesisPtr> Result;
-typedef std::vector<Result> NBestList;
-
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Storage for all hypotheses of one translation. Hypotheses are constructed
+// in place in large blocks and destroyed together with the arena, so a
+// beam step does no heap allocation of its own and chains of hypotheses
+// need no reference counting.
+class HypothesisArena {
+  public:
+    HypothesisArena()
+      : used_(BLOCK_SIZE)
+    {}
 
+    ~HypothesisArena() {
+      Clear();
+    }
+
+    template <class... Args>
+    HypothesisPtr New(Args&&... args) {
+      if (used_ == BLOCK_SIZE) {
+        blocks_.emplace_back(new Storage[BLOCK_SIZE]);
+        used_ = 0;
+      }
+      void* place = &blocks_.back()[used_++];
+      return new (place) Hypothesis(std::forward<Args>(args)...);
+    }
+
+    void Clear() {
+      for (size_t i = 0; i < blocks_.size(); ++i) {
+        size_t count = (i + 1 == blocks_.size()) ? used_ : BLOCK_SIZE;
+        for (size_t j = 0; j < count; ++j) {
+          reinterpret_cast<Hypothesis*>(&blocks_[i][j])->~Hypothesis();
+        }
+      }
+      blocks_.clear();
+      used_ = BLOCK_SIZE;
+    }
+
+  private:
+    static const size_t BLOCK_SIZE = 1024;
+    typedef std::aligned_storage<sizeof(Hypothesis), alignof(Hypothesis)>::type Storage;
+
+    std::vector<std::unique_ptr<Storage[]>> blocks_;
+    size_t used_;
+
+    HypothesisArena(const HypothesisArena&) = delete;
+};
+
+typedef std::shared_ptr<HypothesisArena> HypothesisArenaPtr;
+
+typedef std::pair<Words, HypothesisPtr> Result;
+typedef std::vector<Result> NBestList;
 
 }
 
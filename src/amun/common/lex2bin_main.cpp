@@ -0,0 +1,30 @@
+#include <iostream>
+#include <string>
+
+#include "common/filter.h"
+#include "common/logging.h"
+#include "common/vocab.h"
+
+using namespace amunmt;
+
+int main(int argc, char** argv) {
+  if (argc < 5 || argc > 7) {
+    std::cerr << "Usage: " << argv[0]
+              << " source.yml target.yml lex.txt lex.bin [first-words=10000] [max-translations=1000]" << std::endl;
+    std::cerr << "Converts a lexical table for --softmax-filter to the binary format amun can memory-map." << std::endl;
+    std::cerr << "The number of first words and of translations per word are fixed at conversion." << std::endl;
+    return 1;
+  }
+  unsigned numFirstWords = argc > 5 ? std::stoi(argv[5]) : 10000;
+  unsigned maxNumTranslation = argc > 6 ? std::stoi(argv[6]) : 1000;
+
+  // the parser reports broken lines here
+  spdlog::stderr_logger_mt("info");
+
+  Vocab srcVocab(argv[1]);
+  Vocab trgVocab(argv[2]);
+  std::vector<Words> mapper = Filter::ParseAlignmentFile(srcVocab, trgVocab, argv[3],
+                                                         maxNumTranslation, numFirstWords);
+  Filter::WriteBinary(argv[4], mapper, trgVocab.size(), numFirstWords);
+  return 0;
+}
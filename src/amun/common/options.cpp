@@ -0,0 +1,31 @@
+#include "common/options.h"
+
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+
+namespace amunmt {
+
+Options::Options(const Config& config)
+  : beamSize(config.Get<unsigned>("beam-size")),
+    miniBatch(config.Get<unsigned>("mini-batch")),
+    maxiBatch(config.Get<unsigned>("maxi-batch")),
+    miniBatchWords(config.Get<int>("mini-batch-words")),
+    maxBatchDelay(config.Get<unsigned>("max-batch-delay")),
+    maxLength(config.Get<unsigned>("max-length")),
+    maxLengthFactor(config.Get<float>("max-length-factor")),
+    normalize(config.Get<bool>("normalize")),
+    nBest(config.Get<bool>("n-best")),
+    wipo(config.Get<bool>("wipo")),
+    allowUnk(config.Get<bool>("allow-unk")),
+    noEarlyStop(config.Get<bool>("no-early-stop")),
+    pruneRelative(config.Get<float>("prune-relative")),
+    pruneAbsolute(config.Get<float>("prune-absolute")),
+    filterSoftmax(config.Get<std::vector<std::string>>("softmax-filter").size()),
+    returnAlignment(config.Get<bool>("return-alignment")),
+    returnSoftAlignment(config.Get<bool>("return-soft-alignment")),
+    returnNematusAlignment(config.Get<bool>("return-nematus-alignment"))
+{}
+
+}
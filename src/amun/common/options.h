@@ -0,0 +1,43 @@
+#pragma once
+
+namespace amunmt {
+
+class Config;
+
+// The options read for every sentence or decoder step, converted from the
+// configuration once when God is initialized, so these reads do not go
+// through YAML.
+struct Options
+{
+  Options() = default;
+  explicit Options(const Config& config);
+
+  unsigned beamSize = 12;
+  unsigned miniBatch = 1;
+  unsigned maxiBatch = 1;
+  int miniBatchWords = 0;
+  unsigned maxBatchDelay = 10;
+  unsigned maxLength = 500;
+  float maxLengthFactor = 3.0f;
+
+  bool normalize = false;
+  bool nBest = false;
+  bool wipo = false;
+  bool allowUnk = false;
+  bool noEarlyStop = false;
+  float pruneRelative = 0.0f;
+  float pruneAbsolute = 0.0f;
+  // softmax-filter is set
+  bool filterSoftmax = false;
+
+  bool returnAlignment = false;
+  bool returnSoftAlignment = false;
+  bool returnNematusAlignment = false;
+
+  // any of the three above
+  bool ReturnAttentionWeights() const {
+    return returnAlignment || returnSoftAlignment || returnNematusAlignment;
+  }
+};
+
+}
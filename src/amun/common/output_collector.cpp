@@ -7,52 +7,62 @@ using namespace std;
 namespace amunmt {
 
 OutputCollector::OutputCollector()
- : nextId_(0),
-  outStrm_(&std::cout)
+ : outStrm_(&std::cout),
+  nextId_(0),
+  queue_("output", 1024)
 {
 }
 
+OutputCollector::~OutputCollector()
+{
+  Close();
+}
+
 void OutputCollector::Write(long sourceId, const std::string& output)
 {
-  boost::mutex::scoped_lock lock(mutex_);
-  if (sourceId == nextId_) {
-    LOG(progress)->info("Best translation {} : {}", sourceId, output);
-    *outStrm_ << output << std::endl;
-    
+  std::call_once(started_, [this] { writer_ = std::thread(&OutputCollector::WriteLoop, this); });
+  queue_.Push(std::make_pair(sourceId, output));
+}
+
+void OutputCollector::Close()
+{
+  if (writer_.joinable()) {
+    queue_.Close();
+    writer_.join();
+    queue_.LogStats();
+  }
+}
+
+void OutputCollector::WriteLoop()
+{
+  std::pair<long, std::string> item;
+  while (queue_.Pop(item)) {
+    if (item.first != nextId_) {
+      // save for later
+      outputs_[item.first] = std::move(item.second);
+      continue;
+    }
+
+    LOG(progress)->info("Best translation {} : {}", item.first, item.second);
+    *outStrm_ << item.second << "\n";
     ++nextId_;
 
-    Outputs::const_iterator iter, iterNext;
-    iter = outputs_.begin();
-    while (iter != outputs_.end()) {
-      long currId = iter->first;
-
-      if (currId == nextId_) {
-        // 1st element in the map is the next
-        const string &currOutput = iter->second;
-        LOG(progress)->info("Best translation {} : {}", currId, currOutput);
-        *outStrm_ << currOutput << std::endl;
-
-        ++nextId_;
-
-        // delete current record, move iter on 1
-        iterNext = iter;
-        ++iterNext;
-        outputs_.erase(iter);
-        iter = iterNext;
-      }
-      else {
-        // not the next. stop iterating
-        assert(nextId_ < currId);
-        break;
-      }
+    Outputs::iterator iter = outputs_.begin();
+    while (iter != outputs_.end() && iter->first == nextId_) {
+      LOG(progress)->info("Best translation {} : {}", iter->first, iter->second);
+      *outStrm_ << iter->second << "\n";
+      ++nextId_;
+      iter = outputs_.erase(iter);
     }
+    assert(iter == outputs_.end() || nextId_ < iter->first);
 
+    // flush only when the writer catches up, interactive use still sees
+    // every line at once
+    if (queue_.Empty()) {
+      outStrm_->flush();
+    }
   }
-  else {
-    // save for later
-    outputs_[sourceId] = output;
-  }
+  outStrm_->flush();
 }
 
 }
-
@@ -2,27 +2,39 @@
 
 #include <iostream>
 #include <map>
-#include <boost/thread/mutex.hpp>
-#include <boost/unordered_map.hpp>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "common/bounded_queue.h"
 
 namespace amunmt {
 
+// Writes translations in input order. Write only queues the output, a
+// writer thread started on first use puts it back in order and prints it.
 class OutputCollector {
  public:
   OutputCollector();
   OutputCollector(const OutputCollector&) = delete;
+  ~OutputCollector();
 
   void Write(long sourceId, const std::string& output);
 
+  // Waits until everything written so far is printed
+  void Close();
+
  protected:
+  void WriteLoop();
+
   std::ostream* outStrm_;
-  boost::mutex mutex_;
   long nextId_;
 
   typedef std::map<long, std::string> Outputs;
   Outputs outputs_;
 
+  BoundedQueue<std::pair<long, std::string>> queue_;
+  std::once_flag started_;
+  std::thread writer_;
 };
 
 }
-
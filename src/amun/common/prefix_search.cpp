@@ -0,0 +1,123 @@
+#include "prefix_search.h"
+
+#include <algorithm>
+#include <boost/timer/timer.hpp>
+
+#include "common/god.h"
+#include "common/histories.h"
+#include "common/utils.h"
+#include "common/vocab.h"
+
+using namespace std;
+
+namespace amunmt {
+
+namespace {
+
+// Sessions are created by the caller's thread, so they take no device
+// slot from the translation threads.
+DeviceInfo SessionDevice(const God &god) {
+  DeviceInfo ret;
+  ret.threadInd = 0;
+  ret.deviceId = 0;
+#ifdef HAS_CPU
+  if (god.Get<unsigned>("cpu-threads")) {
+    ret.deviceType = CPUDevice;
+    return ret;
+  }
+#endif
+#ifdef CUDA
+  if (god.Get<unsigned>("gpu-threads")) {
+    ret.deviceType = GPUDevice;
+    ret.deviceId = god.Get<std::vector<unsigned>>("devices")[0];
+    return ret;
+  }
+#endif
+  amunmt_UTIL_THROW2("Interactive translation needs cpu-threads or gpu-threads");
+}
+
+}
+
+PrefixSearch::PrefixSearch(const God &god, const std::string& source)
+  : Search(god, SessionDevice(god)),
+    god_(god),
+    sentences_(new Sentences())
+{
+  sentences_->push_back(SentencePtr(new Sentence(god, 0, source)));
+
+  if (filter_) {
+    FilterTargetVocab(*sentences_);
+  }
+  prefixStates_.push_back(Encode(*sentences_));
+}
+
+PrefixSearch::~PrefixSearch()
+{
+  // batch statistics of single sentences say nothing, skip them
+  std::fill(activeCount_.begin(), activeCount_.end(), 0);
+}
+
+NBestList PrefixSearch::Translate(const Words& prefix) {
+  boost::timer::cpu_timer timer;
+
+  // states of the unchanged start of the prefix are reused
+  unsigned same = 0;
+  while (same < prefix_.size() && same < prefix.size() && prefix_[same] == prefix[same]) {
+    ++same;
+  }
+  prefix_.resize(same);
+  prefixStates_.resize(same + 1);
+
+  arena_.Clear();
+  HypothesisPtr root = arena_.New(sentences_->Get(0));
+  for (unsigned i = same; i < prefix.size(); ++i) {
+    ForceWord(root, prefix[i]);
+  }
+
+  histories_.reset(new Histories(*sentences_, normalizeScore_, maxLengthFactor_));
+  States states = NewStates();
+  Decode(histories_, prefixStates_.back(), states);
+
+  NBestList nbest = histories_->at(0)->NBest(decidedSize_);
+  for (Result& result : nbest) {
+    result.first.insert(result.first.begin(), prefix_.begin(), prefix_.end());
+  }
+
+  LOG(progress)->info("Prefix search with {} new of {} words took {}",
+                      prefix.size() - same, prefix.size(), timer.format(3, "%ws"));
+  return nbest;
+}
+
+std::vector<std::string> PrefixSearch::Translate(const std::string& prefix) {
+  const Vocab& vocab = god_.GetTargetVocab();
+  NBestList nbest = Translate(vocab(prefix, false));
+
+  std::vector<std::string> ret;
+  for (const Result& result : nbest) {
+    ret.push_back(Join(god_.Postprocess(vocab(result.first))));
+  }
+  return ret;
+}
+
+// One decoder step along the prefix. Only the word and the state row of
+// the hypothesis matter for the next decoder input, so its cost is not
+// computed.
+void PrefixSearch::ForceWord(HypothesisPtr root, Word word) {
+  const States& states = prefixStates_.back();
+  States nextStates = NewStates();
+  std::vector<unsigned> beamSizes(1, 1);
+  for (unsigned i = 0; i < scorers_.size(); ++i) {
+    scorers_[i]->Decode(*states[i], *nextStates[i], beamSizes);
+  }
+
+  Beam beam(1, arena_.New(root, word, 0, 0.0f));
+  States forced = NewStates();
+  for (unsigned i = 0; i < scorers_.size(); ++i) {
+    scorers_[i]->AssembleBeamState(*nextStates[i], beam, *forced[i]);
+  }
+
+  prefix_.push_back(word);
+  prefixStates_.push_back(forced);
+}
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/search.h"
+#include "common/sentences.h"
+
+namespace amunmt {
+
+// An interactive translation session for one source sentence, whose
+// translation has to start with a target prefix typed by the user. The
+// source is encoded once and the decoder states after every word of the
+// last prefix are kept, so a prefix that grows or shrinks between calls
+// only costs one decoder step per changed word plus the search for the
+// rest of the translation. Has its own scorers and runs on the calling
+// thread; not thread-safe.
+class PrefixSearch : public Search {
+  public:
+    PrefixSearch(const God &god, const std::string& source);
+    virtual ~PrefixSearch();
+
+    // Best translations starting with prefix, best first: beam-size of them
+    // with n-best, otherwise one. The words include the prefix, the costs
+    // only cover the words after it. Valid until the next call.
+    NBestList Translate(const Words& prefix);
+
+    // Same for a prefix of space separated target tokens, postprocessed
+    std::vector<std::string> Translate(const std::string& prefix);
+
+  private:
+    void ForceWord(HypothesisPtr root, Word word);
+
+    const God &god_;
+    SentencesPtr sentences_;
+
+    Words prefix_;
+    // prefixStates_[i] are the decoder states after the first i words of
+    // prefix_, one per scorer
+    std::vector<States> prefixStates_;
+
+    HypothesisArena arena_;
+    std::shared_ptr<Histories> histories_;
+};
+
+}
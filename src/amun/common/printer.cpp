@@ -7,7 +7,7 @@ namespace amunmt {
 std::vector<unsigned> GetAlignment(const HypothesisPtr& hypothesis) {
   std::vector<SoftAlignment> aligns;
   HypothesisPtr last = hypothesis->GetPrevHyp();
-  while (last->GetPrevHyp().get() != nullptr) {
+  while (last->GetPrevHyp() != nullptr) {
     aligns.push_back(*(last->GetAlignment(0)));
     last = last->GetPrevHyp();
   }
@@ -39,7 +39,7 @@ std::string GetAlignmentString(const std::vector<unsigned>& alignment) {
 std::string GetSoftAlignmentString(const HypothesisPtr& hypothesis) {
   std::vector<SoftAlignment> aligns;
   HypothesisPtr last = hypothesis->GetPrevHyp();
-  while (last->GetPrevHyp().get() != nullptr) {
+  while (last->GetPrevHyp() != nullptr) {
     aligns.push_back(*(last->GetAlignment(0)));
     last = last->GetPrevHyp();
   }
@@ -66,7 +66,7 @@ std::string GetSoftAlignmentString(const HypothesisPtr& hypothesis) {
 std::string GetNematusAlignmentString(const HypothesisPtr& hypothesis, std::string best, std::string source, unsigned linenum) {
   std::vector<SoftAlignment> aligns;
   HypothesisPtr last = hypothesis;
-  while (last->GetPrevHyp().get() != nullptr) {
+  while (last->GetPrevHyp() != nullptr) {
     aligns.push_back(*(last->GetAlignment(0)));
     last = last->GetPrevHyp();
   }
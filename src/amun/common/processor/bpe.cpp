@@ -1,6 +1,7 @@
 #include "common/processor/bpe.h"
 
-#include <mutex>
+#include <algorithm>
+#include <functional>
 #include <sstream>
 #include <iostream>
 
@@ -10,12 +11,26 @@
 
 namespace amunmt {
 
-std::vector<bpeFactors> BPE::Preprocess(const std::vector<bpeFactors> input) const {
-  return Encode(input);
+namespace {
+
+const size_t CACHE_SHARDS = 16;
+const size_t CACHE_SHARD_WORDS = 1 << 14;
+
+// letters that are in no code
+const uint32_t NO_SYMBOL = -1;
+
+uint64_t Key(uint32_t first, uint32_t second) {
+  return (uint64_t(first) << 32) | second;
+}
+
 }
 
-std::vector<std::string> BPE::Preprocess(const std::vector<std::string> input) const {
-  return Encode(input);
+void BPE::Preprocess(std::vector<bpeFactors>& words) const {
+  words = Encode(words);
+}
+
+void BPE::Preprocess(std::vector<std::string>& words) const {
+  words = Encode(words);
 }
 
 std::vector<std::string> BPE::Postprocess(const std::vector<std::string> input) const {
@@ -39,12 +54,13 @@ std::vector<std::string> BPE::Postprocess(const std::vector<std::string> input)
 }
 
 BPE::BPE()
-  : sep_("@@") {}
+  : sep_("@@"),
+    cache_(CACHE_SHARDS) {}
 
 BPE::BPE(std::ifstream&& file, const std::string sep)
-  : sep_(sep) {
+  : sep_(sep),
+    cache_(CACHE_SHARDS) {
   std::string inputLine;
-  size_t index = 0;
   bool firstLine = true;
   while (std::getline(file, inputLine)) {
     if (firstLine) {
@@ -55,7 +71,10 @@ BPE::BPE(std::ifstream&& file, const std::string sep)
     }
     std::vector<std::string> code;
     Split(inputLine, code);
-    bpeCodes_[make_pair(code[0], code[1])] = index++;
+    uint32_t first = Intern(code[0]);
+    uint32_t second = Intern(code[1]);
+    ranks_[Key(first, second)] = codes_.size();
+    codes_.push_back(Code{first, second, Intern(code[0] + code[1])});
   }
 }
 
@@ -97,100 +116,114 @@ void BPE::PrintSegment(const std::string& sentence) {
   }
 }
 
-std::set<BPE::BPEPair> BPE::GetPairs(const std::vector<std::string>& word) const {
-  std::set<BPE::BPEPair> pairSet;
-  for (size_t i = 1; i < word.size(); ++i) {
-    pairSet.emplace(word[i-1], word[i]);
+std::vector<std::string> BPE::Encode(const std::string& word) const {
+  CacheShard& shard = cache_[std::hash<std::string>()(word) % cache_.size()];
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.words.find(word);
+    if (it != shard.words.end()) {
+      return it->second;
+    }
   }
-  return pairSet;
-}
 
-const BPE::BPEPair* BPE::FindBestBigram(const std::set<BPEPair>& pairs) const {
-  size_t minDist = bpeCodes_.size();
-  auto best = bpeCodes_.begin();
+  std::vector<std::string> encoded = Merge(word);
 
-  for (const auto& pair : pairs) {
-    auto it = bpeCodes_.find(pair);
-    if (it == bpeCodes_.end()) {
-      continue;
-    }
-    if (it->second < minDist) {
-      minDist = it->second;
-      best = it;
-    }
-  }
-  if (minDist == bpeCodes_.size()) {
-    return nullptr;
-  }
-  else {
-  return &(best->first);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  // a full shard starts over, frequent words come back soon enough
+  if (shard.words.size() >= CACHE_SHARD_WORDS) {
+    shard.words.clear();
   }
+  shard.words.emplace(word, encoded);
+  return encoded;
 }
 
-std::vector<std::string>& BPE::Encode(const std::string& word) const {
-  if (IsCached(word)) {
-    return cache_[word];
+std::vector<std::string> BPE::Merge(const std::string& word) const {
+  // symbols are byte ranges of the word followed by </w>
+  struct Symbol {
+    uint32_t begin, end;
+    uint32_t id;
+  };
+
+  const std::string padded = word + "</w>";
+  std::vector<Symbol> symbols;
+  const char* b = padded.data();
+  const char* e = b + word.size();
+  while (b != e) {
+    const char* letter = b;
+    utf8::next(b, e);
+    symbols.push_back(Symbol{uint32_t(letter - padded.data()), uint32_t(b - padded.data()), 0});
+  }
+  symbols.push_back(Symbol{uint32_t(word.size()), uint32_t(padded.size()), 0});
+  for (auto& symbol : symbols) {
+    symbol.id = SymbolId(boost::string_view(padded.data() + symbol.begin, symbol.end - symbol.begin));
   }
 
-  std::vector<std::string> vWord = SplitWordIntoLetters(word);
-  vWord.push_back("</w>");
-
-  auto pairs = GetPairs(vWord);
-
-  while (true) {
-    const BPEPair* bigram = FindBestBigram(pairs);
-    if (bigram == nullptr) {
-      break;
+  // ranks of all adjacent pairs with a code; may also hold ranks of pairs
+  // merged away since, their passes below change nothing
+  std::vector<uint32_t> heap;
+  auto push = [&](size_t i) {
+    uint32_t rank = Rank(symbols[i].id, symbols[i + 1].id);
+    if (rank < codes_.size()) {
+      heap.push_back(rank);
+      std::push_heap(heap.begin(), heap.end(), std::greater<uint32_t>());
     }
+  };
+  for (size_t i = 0; i + 1 < symbols.size(); ++i) {
+    push(i);
+  }
 
-    std::vector<std::string> newWord;
-
-    auto it = vWord.begin();
-    while (it != vWord.end()) {
-      auto jt = std::find(it, vWord.end(), bigram->first);
-      for (auto i = it; i != jt; ++i) {
-        newWord.push_back(*i);
+  std::vector<size_t> merged;
+  while (!heap.empty() && symbols.size() > 1) {
+    std::pop_heap(heap.begin(), heap.end(), std::greater<uint32_t>());
+    const Code& code = codes_[heap.back()];
+    heap.pop_back();
+
+    // all occurrences of the pair, left to right
+    merged.clear();
+    size_t out = 0;
+    for (size_t i = 0; i < symbols.size(); ++out) {
+      if (i + 1 < symbols.size() && symbols[i].id == code.first && symbols[i + 1].id == code.second) {
+        symbols[out] = Symbol{symbols[i].begin, symbols[i + 1].end, code.merged};
+        merged.push_back(out);
+        i += 2;
+      } else {
+        symbols[out] = symbols[i];
+        i += 1;
       }
+    }
+    symbols.resize(out);
 
-      if (jt == vWord.end()) {
-        break;
+    for (size_t pos : merged) {
+      if (pos > 0) {
+        push(pos - 1);
       }
-      it = jt;
-
-      if (*it == bigram->first && (it+1) != vWord.end() && *(it+1) == bigram->second) {
-        newWord.emplace_back(bigram->first + bigram->second);
-        it += 2;
-      } else {
-        newWord.push_back(*it);
-        it += 1;
+      if (pos + 1 < symbols.size()) {
+        push(pos);
       }
     }
-    std::swap(vWord, newWord);
-    if (newWord.size() == 1) {
-      break;
-    } else {
-      pairs = GetPairs(vWord);
-    }
+  }
+
+  std::vector<std::string> vWord;
+  vWord.reserve(symbols.size());
+  for (const auto& symbol : symbols) {
+    vWord.emplace_back(padded, symbol.begin, symbol.end - symbol.begin);
   }
 
   if (vWord.back() == "</w>") {
     vWord.pop_back();
   }
+  if (vWord.empty()) {
+    return vWord;
+  }
 
   if (EndsWith(vWord.back(), "</w>")) {
     vWord.back().resize(vWord.back().size() - 4);
   }
 
   for (size_t i = 0;  i < vWord.size() - 1; ++i) {
-    vWord[i] = vWord[i] + sep_;
+    vWord[i] += sep_;
   }
-
-  std::mutex mtx;
-  mtx.lock();
-  cache_[word] = vWord;
-  mtx.unlock();
-
-  return cache_[word];
+  return vWord;
 }
 
 std::vector<bpeFactors> BPE::Encode(const std::vector<bpeFactors>& words) const {
@@ -199,7 +232,7 @@ std::vector<bpeFactors> BPE::Encode(const std::vector<bpeFactors>& words) const
   std::vector<std::vector<std::string>> result;
   for (const bpeFactors& factorlist : words) {
     std::string word = factorlist[0];
-    std::vector<std::string>& encoded = Encode(word);
+    std::vector<std::string> encoded = Encode(word);
     for (const auto& bpePart : encoded)
     {
       result.push_back(bpeFactors());
@@ -214,31 +247,41 @@ std::vector<bpeFactors> BPE::Encode(const std::vector<bpeFactors>& words) const
 std::vector<std::string> BPE::Encode(const std::vector<std::string>& words) const {
   std::vector<std::string> result;
   for (const auto& word : words) {
-    auto& encoded = Encode(word);
+    auto encoded = Encode(word);
     result.insert(result.end(), encoded.begin(), encoded.end());
   }
   return result;
 }
 
 
-bool BPE::IsCached(const std::string& word) const {
-  return cache_.find(word) != cache_.end();
+size_t BPE::StringViewHash::operator()(boost::string_view s) const {
+  // FNV-1a
+  size_t hash = 14695981039346656037ull;
+  for (char c : s) {
+    hash = (hash ^ (unsigned char)c) * 1099511628211ull;
+  }
+  return hash;
 }
 
-std::vector<std::string> BPE::SplitWordIntoLetters(const std::string& word) const {
-  char* charWord = (char*)word.c_str();
-  auto b = charWord;
-  auto e = charWord + strlen(charWord);
-
-  std::vector<std::string> letters;
-  int prevBegin = 0;
-  while (b != e) {
-    int end = utf8::next(b, e);
-    std::vector<unsigned char> utf8result;
-    utf8::utf32to8(&end,&end + 1, std::back_inserter(utf8result));
-    letters.emplace_back(utf8result.begin(), utf8result.end());
+uint32_t BPE::Intern(const std::string& symbol) {
+  auto it = symbolIds_.find(symbol);
+  if (it != symbolIds_.end()) {
+    return it->second;
   }
-  return letters;
+  uint32_t id = symbols_.size();
+  symbols_.push_back(symbol);
+  symbolIds_.emplace(symbols_.back(), id);
+  return id;
+}
+
+uint32_t BPE::SymbolId(boost::string_view symbol) const {
+  auto it = symbolIds_.find(symbol);
+  return it != symbolIds_.end() ? it->second : NO_SYMBOL;
+}
+
+uint32_t BPE::Rank(uint32_t first, uint32_t second) const {
+  auto it = ranks_.find(Key(first, second));
+  return it != ranks_.end() ? it->second : codes_.size();
 }
 
 bool BPE::EndsWith(std::string const &fullString, std::string const suffix) const {
@@ -1,43 +1,25 @@
 #pragma once
 
+#include <cstdint>
+#include <deque>
 #include <vector>
 #include <string>
 #include <fstream>
-#include <set>
+#include <mutex>
 #include <unordered_map>
-#include <iterator>
+#include <boost/utility/string_view.hpp>
 
 #include "common/processor/processor.h"
 
-
-template<class T>
-inline void hash_combine(std::size_t & seed, const T & v)
-{
-  std::hash<T> hasher;
-  seed ^= hasher(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-}
-
-namespace std
-{
-  template<typename S, typename T> struct hash<pair<S, T>>
-  {
-      inline size_t operator()(const pair<S, T> & v) const
-      {
-            size_t seed = 0;
-            ::hash_combine(seed, v.first);
-            ::hash_combine(seed, v.second);
-            return seed;
-          }
-    };
-}
-
 namespace amunmt {
 
 typedef std::vector<std::string> bpeFactors;
 
+// Byte-pair encoding with the codes of subword-nmt. Symbols are interned
+// when the codes are loaded, so a word is merged as a list of symbol ids,
+// always taking the lowest ranked pair from a heap. Encoded words are kept
+// in a sharded cache of bounded size; all methods are thread-safe.
 class BPE : public Processor {
-  using BPEPair = std::pair<std::string, std::string>;
-
   public:
     BPE();
     BPE(std::ifstream&& file, const std::string sep = "@@");
@@ -48,31 +30,50 @@ class BPE : public Processor {
 
     void PrintSegment(const std::string& sentence);
 
-    std::vector<std::string>& Encode(const std::string& word) const;
+    std::vector<std::string> Encode(const std::string& word) const;
 
     std::vector<bpeFactors> Encode(const std::vector<bpeFactors>& words) const;
     std::vector<std::string> Encode(const std::vector<std::string>& words) const;
 
-    std::vector<std::string> Preprocess(const std::vector<std::string> input) const;
-    std::vector<bpeFactors> Preprocess(const std::vector<bpeFactors> input) const;
+    // Same as Encode, without looking into the cache
+    std::vector<std::string> Merge(const std::string& word) const;
+
+    void Preprocess(std::vector<std::string>& words) const;
+    void Preprocess(std::vector<bpeFactors>& words) const;
     std::vector<std::string> Postprocess(const std::vector<std::string> input) const;
 
     virtual ~BPE() {}
   private:
-    std::set<BPEPair> GetPairs(const std::vector<std::string>& word) const;
+    struct StringViewHash {
+      size_t operator()(boost::string_view s) const;
+    };
 
-    const BPEPair* FindBestBigram(const std::set<BPEPair>& pairs) const;
+    struct Code {
+      uint32_t first, second;
+      // the id of first + second
+      uint32_t merged;
+    };
 
-    bool IsCached(const std::string& word) const;
+    struct CacheShard {
+      std::mutex mutex;
+      std::unordered_map<std::string, std::vector<std::string>> words;
+    };
 
-    std::vector<std::string> SplitWordIntoLetters(const std::string& word) const;
+    uint32_t Intern(const std::string& symbol);
+    uint32_t SymbolId(boost::string_view symbol) const;
+    // the rank of the code for the pair, or codes_.size() if there is none
+    uint32_t Rank(uint32_t first, uint32_t second) const;
 
     bool EndsWith(const std::string& fullString, const std::string suffix) const;
 
-    std::unordered_map<BPEPair, size_t> bpeCodes_;
+    // symbol strings, in a deque so the views in symbolIds_ stay valid
+    std::deque<std::string> symbols_;
+    std::unordered_map<boost::string_view, uint32_t, StringViewHash> symbolIds_;
+    // codes by rank, and the rank of each pair of symbol ids
+    std::vector<Code> codes_;
+    std::unordered_map<uint64_t, uint32_t> ranks_;
     const std::string sep_;
-    mutable std::unordered_map<std::string, std::vector<std::string>> cache_;
-
 
+    mutable std::vector<CacheShard> cache_;
 };
 }
@@ -0,0 +1,197 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "utf8/utf8.h"
+#include "common/processor/bpe.h"
+#include "common/utils.h"
+
+using namespace amunmt;
+
+namespace {
+
+// The string based BPE this replaced: pairs of strings in a std::set,
+// all of them looked up again after every merge.
+class LegacyBPE {
+  public:
+    LegacyBPE(const std::string& path) {
+      std::ifstream file(path);
+      std::string line;
+      size_t index = 0;
+      while (std::getline(file, line)) {
+        std::vector<std::string> code;
+        Split(line, code);
+        codes_[code[0] + " " + code[1]] = index++;
+      }
+    }
+
+    std::vector<std::string> Encode(const std::string& word) const {
+      std::vector<std::string> vWord;
+      const char* b = word.data();
+      const char* e = b + word.size();
+      while (b != e) {
+        const char* letter = b;
+        utf8::next(b, e);
+        vWord.emplace_back(letter, b);
+      }
+      vWord.push_back("</w>");
+
+      while (vWord.size() > 1) {
+        std::set<std::pair<std::string, std::string>> pairs;
+        for (size_t i = 1; i < vWord.size(); ++i) {
+          pairs.emplace(vWord[i - 1], vWord[i]);
+        }
+        const std::pair<std::string, std::string>* bigram = nullptr;
+        size_t best = codes_.size();
+        for (const auto& pair : pairs) {
+          auto it = codes_.find(pair.first + " " + pair.second);
+          if (it != codes_.end() && it->second < best) {
+            best = it->second;
+            bigram = &pair;
+          }
+        }
+        if (bigram == nullptr) {
+          break;
+        }
+
+        std::vector<std::string> newWord;
+        for (size_t i = 0; i < vWord.size(); ) {
+          if (i + 1 < vWord.size() && vWord[i] == bigram->first && vWord[i + 1] == bigram->second) {
+            newWord.push_back(bigram->first + bigram->second);
+            i += 2;
+          } else {
+            newWord.push_back(vWord[i++]);
+          }
+        }
+        std::swap(vWord, newWord);
+      }
+
+      if (vWord.back() == "</w>") {
+        vWord.pop_back();
+      }
+      if (vWord.back().size() >= 4 && vWord.back().compare(vWord.back().size() - 4, 4, "</w>") == 0) {
+        vWord.back().resize(vWord.back().size() - 4);
+      }
+      for (size_t i = 0; i + 1 < vWord.size(); ++i) {
+        vWord[i] += "@@";
+      }
+      return vWord;
+    }
+
+  private:
+    std::unordered_map<std::string, size_t> codes_;
+};
+
+template <class F>
+double Seconds(F f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+}
+
+// Segments a tokenized text with the old and the new BPE: every distinct
+// word once without caches, then the whole text through the caches, also
+// from several threads at once. Checks both give the same segmentation.
+int main(int argc, char** argv) {
+  if (argc < 3 || argc > 4) {
+    std::cerr << "Usage: " << argv[0] << " codes text [threads=4]" << std::endl;
+    return 1;
+  }
+  unsigned numThreads = argc > 3 ? std::atoi(argv[3]) : 4;
+
+  std::vector<std::string> tokens;
+  {
+    std::ifstream text(argv[2]);
+    std::string line;
+    while (std::getline(text, line)) {
+      std::vector<std::string> words;
+      Split(line, words);
+      for (auto& word : words) {
+        if (!word.empty()) {
+          tokens.push_back(std::move(word));
+        }
+      }
+    }
+  }
+  std::unordered_set<std::string> distinctSet(tokens.begin(), tokens.end());
+  std::vector<std::string> distinct(distinctSet.begin(), distinctSet.end());
+  std::cout << tokens.size() << " tokens, " << distinct.size() << " distinct" << std::endl;
+
+  LegacyBPE legacy(argv[1]);
+  BPE bpe(argv[1]);
+
+  size_t mismatches = 0;
+  for (const auto& word : distinct) {
+    if (legacy.Encode(word) != bpe.Merge(word)) {
+      if (mismatches++ < 10) {
+        std::cout << "mismatch: " << word << std::endl;
+      }
+    }
+  }
+  std::cout << mismatches << " mismatches" << std::endl;
+
+  size_t pieces = 0;
+  double legacyTime = Seconds([&]() {
+    for (const auto& word : distinct) {
+      pieces += legacy.Encode(word).size();
+    }
+  });
+  double mergeTime = Seconds([&]() {
+    for (const auto& word : distinct) {
+      pieces += bpe.Merge(word).size();
+    }
+  });
+  std::cout << "distinct words/s: old " << distinct.size() / legacyTime
+            << ", new " << distinct.size() / mergeTime
+            << ", speedup " << legacyTime / mergeTime << "x" << std::endl;
+
+  // the old cache: an unbounded map, only usable from one thread
+  std::unordered_map<std::string, std::vector<std::string>> legacyCache;
+  double legacyCachedTime = Seconds([&]() {
+    for (const auto& token : tokens) {
+      auto it = legacyCache.find(token);
+      if (it == legacyCache.end()) {
+        it = legacyCache.emplace(token, legacy.Encode(token)).first;
+      }
+      pieces += it->second.size();
+    }
+  });
+
+  BPE cached(argv[1]);
+  double cachedTime = Seconds([&]() {
+    for (const auto& token : tokens) {
+      pieces += cached.Encode(token).size();
+    }
+  });
+
+  BPE shared(argv[1]);
+  double threadedTime = Seconds([&]() {
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < numThreads; ++t) {
+      threads.emplace_back([&, t]() {
+        for (size_t i = t; i < tokens.size(); i += numThreads) {
+          shared.Encode(tokens[i]);
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  });
+
+  std::cout << "tokens/s with cache: old " << tokens.size() / legacyCachedTime
+            << ", new " << tokens.size() / cachedTime
+            << ", new with " << numThreads << " threads " << tokens.size() / threadedTime
+            << std::endl;
+  std::cerr << pieces << " pieces" << std::endl;
+
+  return mismatches == 0 ? 0 : 1;
+}
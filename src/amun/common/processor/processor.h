@@ -8,8 +8,9 @@ namespace amunmt {
 
 class Preprocessor {
   public:
-    virtual std::vector<std::string> Preprocess(const std::vector<std::string> input) const = 0;
-    virtual std::vector<std::vector<std::string>> Preprocess(const std::vector<std::vector<std::string>> input) const = 0;
+    // in place, words may be replaced by several
+    virtual void Preprocess(std::vector<std::string>& words) const = 0;
+    virtual void Preprocess(std::vector<std::vector<std::string>>& words) const = 0;
     virtual ~Preprocessor() {}
 };
 
@@ -0,0 +1,145 @@
+#include "request_batcher.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "common/god.h"
+#include "common/histories.h"
+#include "common/printer.h"
+#include "common/sentences.h"
+#include "common/translation_task.h"
+
+using namespace std;
+
+namespace amunmt {
+
+RequestBatcher::RequestBatcher(God &god)
+  : god_(god),
+    miniSize_(std::max(1u, god.GetOptions().miniBatch)),
+    miniWords_(god.GetOptions().miniBatchWords),
+    maxDelay_(god.GetOptions().maxBatchDelay),
+    pendingWords_(0),
+    stop_(false),
+    dispatcher_(&RequestBatcher::Dispatch, this)
+{}
+
+RequestBatcher::~RequestBatcher() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  condition_.notify_all();
+  dispatcher_.join();
+}
+
+std::future<std::vector<std::string>> RequestBatcher::Translate(const std::vector<std::string>& lines) {
+  RequestPtr request(new Request());
+  request->output.resize(lines.size());
+  request->remaining = lines.size();
+  std::future<std::vector<std::string>> result = request->promise.get_future();
+
+  if (lines.empty()) {
+    request->promise.set_value(std::vector<std::string>());
+    return result;
+  }
+
+  // preprocessing and cache lookups run in the calling thread, outside
+  // the lock
+  TranslationCache* cache = god_.GetTranslationCache();
+  std::vector<Pending> sentences;
+  for (unsigned i = 0; i < lines.size(); ++i) {
+    SentencePtr sentence(new Sentence(god_, i, lines[i]));
+    if (cache && cache->Get(*sentence, request->output[i])) {
+      --request->remaining;
+      continue;
+    }
+    sentences.push_back(Pending{sentence, request, i, Clock::time_point()});
+  }
+
+  if (sentences.empty()) {
+    request->promise.set_value(std::move(request->output));
+    return result;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Clock::time_point now = Clock::now();
+    for (Pending& pending : sentences) {
+      pending.arrival = now;
+      pendingWords_ += pending.sentence->size();
+      pending_.push_back(std::move(pending));
+    }
+  }
+  condition_.notify_one();
+
+  return result;
+}
+
+bool RequestBatcher::BatchFull() const {
+  return pending_.size() >= miniSize_
+      || (miniWords_ > 0 && pendingWords_ >= (unsigned)miniWords_);
+}
+
+void RequestBatcher::Dispatch() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    condition_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+    if (pending_.empty()) {
+      return;
+    }
+
+    Clock::time_point deadline = pending_.front().arrival + maxDelay_;
+    condition_.wait_until(lock, deadline, [this] { return stop_ || BatchFull(); });
+
+    std::vector<Pending> batch;
+    unsigned words = 0;
+    while (!pending_.empty() && batch.size() < miniSize_) {
+      unsigned length = pending_.front().sentence->size();
+      if (miniWords_ > 0 && !batch.empty() && words + length > (unsigned)miniWords_) {
+        break;
+      }
+      words += length;
+      batch.push_back(std::move(pending_.front()));
+      pending_.pop_front();
+    }
+    pendingWords_ -= words;
+
+    // the pool is bounded, so this blocks while all workers are busy and
+    // requests arriving meanwhile fill up the next batch
+    lock.unlock();
+    god_.GetThreadPool().post([this, batch]() mutable { Process(std::move(batch)); });
+    lock.lock();
+  }
+}
+
+void RequestBatcher::Process(std::vector<Pending> batch) const {
+  // longest first as in amun's own batches, histories come back in the
+  // order of the sentences
+  std::stable_sort(batch.begin(), batch.end(), [](const Pending& a, const Pending& b) {
+    return a.sentence->size() > b.sentence->size();
+  });
+
+  SentencesPtr sentences(new Sentences());
+  for (const Pending& pending : batch) {
+    sentences->push_back(pending.sentence);
+  }
+
+  std::shared_ptr<Histories> histories = TranslationTask(god_, sentences);
+
+  for (unsigned i = 0; i < histories->size(); ++i) {
+    std::stringstream strm;
+    Printer(god_, *histories->at(i), strm, sentences->Get(i));
+
+    if (TranslationCache* cache = god_.GetTranslationCache()) {
+      cache->Put(sentences->Get(i), strm.str());
+    }
+
+    Request &request = *batch[i].request;
+    request.output[batch[i].index] = strm.str();
+    if (--request.remaining == 0) {
+      request.promise.set_value(std::move(request.output));
+    }
+  }
+}
+
+}
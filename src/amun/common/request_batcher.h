@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/sentence.h"
+
+namespace amunmt {
+
+class God;
+
+// Collects the sentences of concurrent translation requests and hands
+// them to the translation thread pool in mini-batches. A batch is sent as
+// soon as it reaches mini-batch sentences or mini-batch-words source words,
+// or when its oldest sentence has waited max-batch-delay milliseconds.
+// Sentences of one request may end up in different batches, and one batch
+// usually mixes several requests.
+class RequestBatcher {
+  public:
+    RequestBatcher(God &god);
+    ~RequestBatcher();
+
+    // Translations of lines, in the same order and printed as amun would.
+    // Line numbers in n-best lists count from 0 within each request.
+    std::future<std::vector<std::string>> Translate(const std::vector<std::string>& lines);
+
+  private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Request {
+      std::vector<std::string> output;
+      std::atomic<unsigned> remaining;
+      std::promise<std::vector<std::string>> promise;
+    };
+    typedef std::shared_ptr<Request> RequestPtr;
+
+    struct Pending {
+      SentencePtr sentence;
+      RequestPtr request;
+      unsigned index;
+      Clock::time_point arrival;
+    };
+
+    bool BatchFull() const;
+    void Dispatch();
+    void Process(std::vector<Pending> batch) const;
+
+    God &god_;
+    const unsigned miniSize_;
+    const int miniWords_;
+    const std::chrono::milliseconds maxDelay_;
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::deque<Pending> pending_;
+    unsigned pendingWords_;
+    bool stop_;
+
+    std::thread dispatcher_;
+
+    RequestBatcher(const RequestBatcher&) = delete;
+};
+
+}
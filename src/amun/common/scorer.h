@@ -12,8 +12,6 @@ namespace amunmt {
 
 class God;
 class Sentences;
-class Hypothesis;
-typedef std::shared_ptr<Hypothesis> HypothesisPtr;
 typedef std::vector<HypothesisPtr> Beam;
 
 
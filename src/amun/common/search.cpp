@@ -6,6 +6,7 @@
 #include "common/histories.h"
 #include "common/filter.h"
 #include "common/base_tensor.h"
+#include "common/cpu_topology.h"
 
 #ifdef CUDA
 #include <cuda.h>
@@ -16,15 +17,63 @@ using namespace std;
 
 namespace amunmt {
 
+namespace {
+
+// Stopping early assumes that costs only decrease, which negative scorer
+// weights would break.
+bool CanStopEarly(const God &god) {
+  if (god.GetOptions().noEarlyStop) {
+    return false;
+  }
+  for (auto& weight : god.GetScorerWeights()) {
+    if (weight.second < 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Pins a CPU thread placed by cpu-affinity before its scorers are created,
+// so that what they allocate is local to its NUMA node.
+const DeviceInfo& Pinned(const DeviceInfo& deviceInfo) {
+  if (deviceInfo.deviceType == CPUDevice && deviceInfo.cpu >= 0) {
+    if (PinCurrentThread({deviceInfo.cpu})) {
+      LOG(info)->info("CPU thread {} pinned to CPU {} on NUMA node {}",
+                      deviceInfo.threadInd, deviceInfo.cpu, deviceInfo.numaNode);
+    } else {
+      LOG(info)->warn("Cannot pin CPU thread {} to CPU {}", deviceInfo.threadInd, deviceInfo.cpu);
+    }
+  }
+  return deviceInfo;
+}
+
+}
+
 Search::Search(const God &god)
-  : deviceInfo_(god.GetNextDevice()),
+  : Search(god, god.GetNextDevice())
+{}
+
+Search::Search(const God &god, const DeviceInfo &deviceInfo)
+  : deviceInfo_(Pinned(deviceInfo)),
     scorers_(god.GetScorers(deviceInfo_)),
     filter_(god.GetFilter()),
-    maxBeamSize_(god.Get<unsigned>("beam-size")),
-    normalizeScore_(god.Get<bool>("normalize")),
+    maxBeamSize_(god.GetOptions().beamSize),
+    normalizeScore_(god.GetOptions().normalize),
+    maxLengthFactor_(god.GetOptions().maxLengthFactor),
+    earlyStop_(CanStopEarly(god)),
+    decidedSize_(god.GetOptions().nBest ? god.GetOptions().beamSize : 1),
     bestHyps_(god.GetBestHyps(deviceInfo_))
 {
-  activeCount_.resize(god.Get<unsigned>("mini-batch") + 1, 0);
+  activeCount_.resize(god.GetOptions().miniBatch + 1, 0);
+
+#ifdef HAS_CPU
+  if (deviceInfo_.deviceType == CPUDevice) {
+    scorerThreads_ = std::min<unsigned>(god.Get<unsigned>("cpu-scorer-threads"), scorers_.size());
+    if (scorerThreads_ > 1) {
+      scorerPool_.reset(new ThreadPool(scorerThreads_ - 1));
+    }
+  }
+#endif
 }
 
 
@@ -52,16 +101,26 @@ std::shared_ptr<Histories> Search::Translate(const Sentences& sentences) {
   }
 
   States states = Encode(sentences);
-  States nextStates = NewStates();
-  std::vector<unsigned> beamSizes(sentences.size(), 1);
+  std::shared_ptr<Histories> histories(new Histories(sentences, normalizeScore_, maxLengthFactor_));
+  Decode(histories, states, states);
+
+  CleanAfterTranslation();
 
-  std::shared_ptr<Histories> histories(new Histories(sentences, normalizeScore_));
+  LOG(progress)->info("Search took {}", timer.format(3, "%ws"));
+  return histories;
+}
+
+void Search::Decode(std::shared_ptr<Histories>& histories, const States& start, States& states) {
+  States nextStates = NewStates();
+  std::vector<unsigned> beamSizes(histories->size(), 1);
   Beam prevHyps = histories->GetFirstHyps();
 
-  for (unsigned decoderStep = 0; decoderStep < 3 * sentences.GetMaxLength(); ++decoderStep) {
-    for (unsigned i = 0; i < scorers_.size(); i++) {
-      scorers_[i]->Decode(*states[i], *nextStates[i], beamSizes);
-    }
+  unsigned maxLength = histories->GetMaxLength();
+  for (unsigned decoderStep = 0; decoderStep < maxLength; ++decoderStep) {
+    const States& in = decoderStep == 0 ? start : states;
+    ForEachScorer([&](unsigned i) {
+      scorers_[i]->Decode(*in[i], *nextStates[i], beamSizes);
+    });
 
     if (decoderStep == 0) {
       for (auto& beamSize : beamSizes) {
@@ -79,21 +138,15 @@ std::shared_ptr<Histories> Search::Translate(const Sentences& sentences) {
     //cerr << "beamSizes=" << beamSizes.size() << " " << histories->NumActive() << endl;
     ++activeCount_[histories->NumActive()];
   }
-
-  CleanAfterTranslation();
-
-  LOG(progress)->info("Search took {}", timer.format(3, "%ws"));
-  return histories;
 }
 
 States Search::Encode(const Sentences& sentences) {
-  States states;
-  for (auto& scorer : scorers_) {
-    scorer->Encode(sentences);
-    auto state = scorer->NewState();
-    scorer->BeginSentenceState(*state, sentences.size());
-    states.emplace_back(state);
-  }
+  States states(scorers_.size());
+  ForEachScorer([&](unsigned i) {
+    scorers_[i]->Encode(sentences);
+    states[i].reset(scorers_[i]->NewState());
+    scorers_[i]->BeginSentenceState(*states[i], sentences.size());
+  });
   return states;
 }
 
@@ -106,12 +159,17 @@ bool Search::CalcBeam(
 {
     unsigned batchSize = beamSizes.size();
     Beams beams(batchSize);
-    bestHyps_->CalcBeam(prevHyps, scorers_, filterIndices_, beams, beamSizes);
+    bestHyps_->CalcBeam(prevHyps, scorers_, filterIndices_, histories->GetArena(), beams, beamSizes);
     histories->Add(beams);
 
     histories->SetActive(false);
     Beam survivors;
     for (unsigned batchId = 0; batchId < batchSize; ++batchId) {
+      if (!beams[batchId].empty() && IsFinished(*histories->at(batchId), beams[batchId])) {
+        beamSizes[batchId] = 0;
+        continue;
+      }
+
       for (auto& h : beams[batchId]) {
         if (h->GetWord() != EOS_ID) {
           survivors.push_back(h);
@@ -127,15 +185,61 @@ bool Search::CalcBeam(
       return false;
     }
 
-    for (unsigned i = 0; i < scorers_.size(); i++) {
+    ForEachScorer([&](unsigned i) {
       scorers_[i]->AssembleBeamState(*nextStates[i], survivors, *states[i]);
-    }
+    });
 
     //cerr << "survivors=" << survivors.size() << endl;
     prevHyps.swap(survivors);
     return true;
 }
 
+bool Search::IsFinished(const History& history, const Beam& beam) const
+{
+  // the history takes every hypothesis as final at its length limit
+  return history.size() > history.GetMaxLength()
+      || (earlyStop_ && history.IsDecided(beam, decidedSize_));
+}
+
+void Search::ForEachScorer(const std::function<void(unsigned)>& f)
+{
+  if (!scorerPool_) {
+    for (unsigned i = 0; i < scorers_.size(); ++i) {
+      f(i);
+    }
+    return;
+  }
+
+  // scorer i goes to thread i % threads, thread 0 being the calling one
+  const unsigned threads = scorerThreads_;
+  auto run = [&](unsigned first) {
+    for (unsigned i = first; i < scorers_.size(); i += threads) {
+      f(i);
+    }
+  };
+
+  std::vector<std::future<void>> results;
+  for (unsigned t = 1; t < threads; ++t) {
+    results.push_back(scorerPool_->enqueue(run, t));
+  }
+
+  // the helpers use f and run, wait for them before leaving on an error
+  std::exception_ptr error;
+  try {
+    run(0);
+  } catch (...) {
+    error = std::current_exception();
+  }
+  for (auto& result : results) {
+    result.wait();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  for (auto& result : results) {
+    result.get();
+  }
+}
 
 States Search::NewStates() const {
   States states;
@@ -147,13 +251,13 @@ States Search::NewStates() const {
 
 void Search::FilterTargetVocab(const Sentences& sentences) {
   unsigned vocabSize = scorers_[0]->GetVocabSize();
-  std::set<Word> srcWords;
+  Words srcWords;
   for (unsigned i = 0; i < sentences.size(); ++i) {
-    const Sentence& sentence = sentences.Get(i);
-    for (const auto& srcWord : sentence.GetWords()) {
-      srcWords.insert(srcWord);
-    }
+    const Words& words = sentences.Get(i).GetWords();
+    srcWords.insert(srcWords.end(), words.begin(), words.end());
   }
+  std::sort(srcWords.begin(), srcWords.end());
+  srcWords.erase(std::unique(srcWords.begin(), srcWords.end()), srcWords.end());
 
   filterIndices_ = filter_->GetFilteredVocab(srcWords, vocabSize);
   for (auto& scorer : scorers_) {
@@ -167,6 +271,9 @@ void Search::BatchStats()
   for (size_t i = 0; i < activeCount_.size(); ++i) {
     sum += activeCount_[i];
   }
+  if (sum == 0) {
+    return;
+  }
 
   cerr << "batches: ";
   for (size_t i = 0; i < activeCount_.size(); ++i) {
@@ -1,20 +1,23 @@
 #pragma once
 
+#include <functional>
 #include <memory>
-#include <set>
 
 #include "common/scorer.h"
 #include "common/sentence.h"
 #include "common/base_best_hyps.h"
+#include "common/threadpool.h"
 
 namespace amunmt {
 
+class History;
 class Histories;
 class Filter;
 
 class Search {
   public:
     Search(const God &god);
+    Search(const God &god, const DeviceInfo &deviceInfo);
     virtual ~Search();
 
     std::shared_ptr<Histories> Translate(const Sentences& sentences);
@@ -23,6 +26,10 @@ class Search {
     States NewStates() const;
     void FilterTargetVocab(const Sentences& sentences);
     States Encode(const Sentences& sentences);
+
+    // Beam search for all histories, starting from the decoder states start.
+    // states is overwritten with the states of later steps and may be start.
+    void Decode(std::shared_ptr<Histories>& histories, const States& start, States& states);
     void CleanAfterTranslation();
 
     bool CalcBeam(
@@ -32,6 +39,14 @@ class Search {
     		States& states,
     		States& nextStates);
 
+    // Whether a sentence needs no more decoding steps after beam was added
+    // to its history
+    bool IsFinished(const History& history, const Beam& beam) const;
+
+    // Calls f for the index of every scorer, spread over scorerPool_ and
+    // the calling thread when there is a pool, and returns once all are done
+    void ForEachScorer(const std::function<void(unsigned)>& f);
+
     Search(const Search&) = delete;
 
   protected:
@@ -40,8 +55,15 @@ class Search {
     std::shared_ptr<const Filter> filter_;
     const unsigned maxBeamSize_;
     bool normalizeScore_;
+    const float maxLengthFactor_;
+    const bool earlyStop_;
+    // number of translations that have to be settled before stopping early
+    const unsigned decidedSize_;
     Words filterIndices_;
     BaseBestHypsPtr bestHyps_;
+    // helpers running ensemble members concurrently, cpu-scorer-threads
+    std::unique_ptr<ThreadPool> scorerPool_;
+    unsigned scorerThreads_ = 1;
 
     std::vector<unsigned> activeCount_;
     void BatchStats();
@@ -10,32 +10,39 @@ namespace amunmt {
 Sentence::Sentence(const God &god, unsigned vLineNum, const std::string& line)
   : lineNum_(vLineNum)
 {
-  std::vector<std::string> tabs;
-  Split(line, tabs, "\t");
+  // tokens and factors are looked up in the vocabularies where they are in
+  // line, they are only copied into strings for preprocessors like BPE
+  std::vector<boost::string_view> tabs;
+  Split(line, tabs, '\t');
   if (tabs.size() == 0) {
-    tabs.push_back("");
+    tabs.push_back(boost::string_view());
   }
 
-  unsigned maxLength = god.Get<unsigned>("max-length");
+  unsigned maxLength = god.GetOptions().maxLength;
   unsigned i = 0;
-  for (auto& tab : tabs) {
-    std::vector<std::string> lineTokens;
-    Trim(tab);
-    Split(tab, lineTokens, " ");
+  std::vector<boost::string_view> lineTokens;
+  for (auto tab : tabs) {
+    lineTokens.clear();
+    Split(Trim(tab), lineTokens, ' ');
 
     if (maxLength && lineTokens.size() > maxLength) {
       lineTokens.resize(maxLength);
     }
 
-    std::vector<std::vector<std::string>> lineFactors;
-    for (const std::string& token : lineTokens) {
+    if (god.HasPreprocessors(i)) {
+      std::vector<std::vector<std::string>> lineFactors;
       std::vector<std::string> wordFactors;
-      Split(token, wordFactors, "|");
-      lineFactors.push_back(wordFactors);
+      for (boost::string_view token : lineTokens) {
+        wordFactors.clear();
+        Split(token.to_string(), wordFactors, "|");
+        lineFactors.push_back(wordFactors);
+      }
+
+      god.Preprocess(i, lineFactors);
+      factors_.emplace_back(god.GetSourceVocabs(i)(lineFactors));
+    } else {
+      factors_.emplace_back(god.GetSourceVocabs(i)(lineTokens));
     }
-
-    auto processed = god.Preprocess(i, lineFactors);
-    factors_.emplace_back(god.GetSourceVocabs(i)(processed));
     Words lineWords(factors_.back().size());
     for (unsigned i = 0; i < factors_.back().size(); ++i) {
       lineWords[i] = factors_.back()[i][0];
@@ -47,8 +54,13 @@ Sentence::Sentence(const God &god, unsigned vLineNum, const std::string& line)
 
 Sentence::Sentence(const God &god, unsigned lineNum, const std::vector<std::string>& words)
   : lineNum_(lineNum) {
-    auto processed = god.Preprocess(0, words);
-    words_.push_back(god.GetSourceVocab(0)(processed));
+    if (god.HasPreprocessors(0)) {
+      std::vector<std::string> processed = words;
+      god.Preprocess(0, processed);
+      words_.push_back(god.GetSourceVocab(0)(processed));
+    } else {
+      words_.push_back(god.GetSourceVocab(0)(words));
+    }
     // fill in the factors as well so that there aren't any surprises
     // if somebody decides to look up the factors in the decoder or something
     FillDummyFactors(words_.back());
@@ -86,6 +98,10 @@ unsigned Sentence::size(unsigned index) const {
   return words_[index].size();
 }
 
+unsigned Sentence::GetNumTabs() const {
+  return factors_.size();
+}
+
 
 }
 
@@ -18,6 +18,7 @@ class Sentence {
     const Words& GetWords(unsigned index = 0) const;
     const FactWords& GetFactors(unsigned index = 0) const;
     unsigned size(unsigned index = 0) const;
+    unsigned GetNumTabs() const;
 
     unsigned GetLineNum() const;
 
@@ -0,0 +1,130 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
+
+#include "common/god.h"
+#include "common/logging.h"
+#include "common/request_batcher.h"
+
+using namespace amunmt;
+using namespace std;
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace websocket = beast::websocket;
+using tcp = boost::asio::ip::tcp;
+
+namespace {
+
+std::vector<std::string> SplitLines(const std::string& text) {
+  std::vector<std::string> lines;
+  size_t start = 0;
+  while (start < text.size()) {
+    size_t end = text.find('\n', start);
+    if (end == std::string::npos) {
+      end = text.size();
+    }
+    lines.push_back(text.substr(start, end - start));
+    start = end + 1;
+  }
+  return lines;
+}
+
+std::string JoinLines(const std::vector<std::string>& lines) {
+  std::string text;
+  for (const std::string& line : lines) {
+    text += line;
+    text += '\n';
+  }
+  return text;
+}
+
+std::string Translate(RequestBatcher& batcher, const std::string& text) {
+  return JoinLines(batcher.Translate(SplitLines(text)).get());
+}
+
+http::response<http::string_body> Respond(RequestBatcher& batcher,
+                                          const http::request<http::string_body>& req) {
+  http::response<http::string_body> res;
+  res.version(req.version());
+  res.keep_alive(req.keep_alive());
+  res.set(http::field::content_type, "text/plain; charset=utf-8");
+
+  if (req.target() != "/translate") {
+    res.result(http::status::not_found);
+    res.body() = "Unknown path, use /translate\n";
+  } else if (req.method() != http::verb::post) {
+    res.result(http::status::method_not_allowed);
+    res.body() = "POST one sentence per line or open a WebSocket\n";
+  } else {
+    res.result(http::status::ok);
+    res.body() = Translate(batcher, req.body());
+  }
+  res.prepare_payload();
+  return res;
+}
+
+// One connection: plain HTTP requests until the client closes, or a
+// WebSocket on which every message is translated like a POST body.
+void Session(tcp::socket socket, RequestBatcher& batcher) {
+  try {
+    beast::flat_buffer buffer;
+    for (;;) {
+      http::request<http::string_body> req;
+      http::read(socket, buffer, req);
+
+      if (websocket::is_upgrade(req)) {
+        websocket::stream<tcp::socket> ws(std::move(socket));
+        ws.accept(req);
+        for (;;) {
+          beast::flat_buffer message;
+          ws.read(message);
+          ws.text(true);
+          ws.write(boost::asio::buffer(Translate(batcher, beast::buffers_to_string(message.data()))));
+        }
+      }
+
+      http::response<http::string_body> res = Respond(batcher, req);
+      http::write(socket, res);
+      if (!res.keep_alive()) {
+        socket.shutdown(tcp::socket::shutdown_send);
+        return;
+      }
+    }
+  }
+  catch (beast::system_error& e) {
+    if (e.code() != http::error::end_of_stream && e.code() != websocket::error::closed) {
+      LOG(info)->info("Connection closed: {}", e.code().message());
+    }
+  }
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  God god;
+  god.Init(argc, argv);
+
+  RequestBatcher batcher(god);
+
+  unsigned short port = god.Get<unsigned>("port");
+  boost::asio::io_context ioc;
+  tcp::acceptor acceptor(ioc, tcp::endpoint(tcp::v4(), port));
+  LOG(info)->info("Listening on port {}, POST to or open a WebSocket on /translate", port);
+
+  for (;;) {
+    tcp::socket socket(ioc);
+    acceptor.accept(socket);
+    std::thread(Session, std::move(socket), std::ref(batcher)).detach();
+  }
+
+  god.Cleanup();
+  return 0;
+}
@@ -22,74 +22,243 @@ freely, subject to the following restrictions:
    distribution.
 
 
-This source code has been modified to have optional bounded size.
+This source code has been modified to have optional bounded size, and
+since to have a queue per worker with work stealing, task priorities and
+tasks stored without allocation.
 */
 
 #pragma once
 
-#include <iostream>
-#include <vector>
-#include <queue>
-#include <memory>
-#include <thread>
-#include <mutex>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
-#include <future>
+#include <cstdint>
+#include <deque>
 #include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common/logging.h"
 
 namespace amunmt {
 
+// Every worker has its own queues. Tasks added from outside the pool go to
+// the workers in turn, tasks added by a worker to its own queues. A worker
+// runs the oldest task of its queues and, when they are empty, steals the
+// oldest task of another worker, so workers seldom wait for the same lock.
+// High priority tasks run before all normal ones.
 class ThreadPool {
  public:
+    enum class Priority { Normal = 0, High = 1 };
+
+    struct Stats {
+      uint64_t tasks;      // run
+      uint64_t steals;     // taken from the queue of another worker
+      uint64_t contended;  // queue locks that were held by another thread
+      uint64_t sleeps;     // times a worker found nothing to do
+      uint64_t fullWaits;  // times a bounded pool made the caller wait
+      // from adding a task until it starts
+      double meanWaitUs;
+      double maxWaitUs;
+    };
+
     explicit ThreadPool(size_t threads, size_t bound /* bound on size, or 0 for unbounded */ = 0);
 
     template<class F, class... Args>
     auto enqueue(F&& f, Args&&... args)
         -> std::future<typename std::result_of<F(Args...)>::type>;
+
+    // Runs f() without a future. Small functions are moved into the queue
+    // itself, so nothing is allocated for them.
+    template<class F>
+    void post(F&& f, Priority priority = Priority::Normal);
+
+    // Runs the tasks still queued and joins the workers
+    void stop();
     ~ThreadPool();
 
     size_t getNumTasks() const {
-      return tasks.size();
+      return std::max<int64_t>(pending_, 0);
     }
 
+    Stats getStats() const;
+    void logStats(const std::string& name) const;
+
  private:
-    // need to keep track of threads so we can join them
-    std::vector<std::thread> workers;
-    // the task queue
-    std::queue< std::function<void()> > tasks;
-
-    // synchronization
-    std::mutex queue_mutex;
-    std::condition_variable condition;
-    std::size_t bound;
-    std::condition_variable bounded_condition;
-    bool stop;
+    // A void() function that can only be moved, stored in place when small
+    class Task {
+     public:
+      Task() : ops_(nullptr) {}
+
+      template<class F>
+      explicit Task(F&& f) : ops_(nullptr) {
+        typedef typename std::decay<F>::type Function;
+        if (sizeof(Function) <= sizeof(storage_) && alignof(Function) <= alignof(Storage)
+            && std::is_nothrow_move_constructible<Function>::value) {
+          new (&storage_) Function(std::forward<F>(f));
+          ops_ = &InlineOps<Function>::ops;
+        } else {
+          *reinterpret_cast<Function**>(&storage_) = new Function(std::forward<F>(f));
+          ops_ = &HeapOps<Function>::ops;
+        }
+      }
+
+      Task(Task&& other) noexcept : ops_(other.ops_) {
+        if (ops_) {
+          ops_->move(&storage_, &other.storage_);
+          other.ops_ = nullptr;
+        }
+      }
+
+      Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+          reset();
+          ops_ = other.ops_;
+          if (ops_) {
+            ops_->move(&storage_, &other.storage_);
+            other.ops_ = nullptr;
+          }
+        }
+        return *this;
+      }
+
+      ~Task() {
+        reset();
+      }
+
+      void operator()() {
+        ops_->invoke(&storage_);
+      }
+
+      void reset() {
+        if (ops_) {
+          ops_->destroy(&storage_);
+          ops_ = nullptr;
+        }
+      }
+
+     private:
+      typedef std::aligned_storage<64, alignof(std::max_align_t)>::type Storage;
+
+      struct Ops {
+        void (*invoke)(void*);
+        // move constructs at to and destroys from
+        void (*move)(void* to, void* from);
+        void (*destroy)(void*);
+      };
+
+      template<class F>
+      struct InlineOps {
+        static void Invoke(void* p) { (*static_cast<F*>(p))(); }
+        static void Move(void* to, void* from) {
+          new (to) F(std::move(*static_cast<F*>(from)));
+          static_cast<F*>(from)->~F();
+        }
+        static void Destroy(void* p) { static_cast<F*>(p)->~F(); }
+        static const Ops ops;
+      };
+
+      template<class F>
+      struct HeapOps {
+        static void Invoke(void* p) { (**static_cast<F**>(p))(); }
+        static void Move(void* to, void* from) { *static_cast<F**>(to) = *static_cast<F**>(from); }
+        static void Destroy(void* p) { delete *static_cast<F**>(p); }
+        static const Ops ops;
+      };
+
+      const Ops* ops_;
+      Storage storage_;
+    };
+
+    struct Entry {
+      Task task;
+      std::chrono::steady_clock::time_point added;
+    };
+
+    struct Queue {
+      std::mutex mutex;
+      // by priority
+      std::deque<Entry> tasks[2];
+      // sizes of tasks, read without the lock to skip empty queues
+      std::atomic<size_t> sizes[2];
+
+      Queue() : sizes{{0}, {0}} {}
+    };
+
+    void push(Task&& task, Priority priority);
+    bool pop(size_t worker, Entry& entry);
+    void work(size_t worker);
+    void waitNotFull();
+    std::unique_lock<std::mutex> lock(Queue& queue);
+
+    // the pool and index of the worker running on this thread, if any
+    static std::pair<const ThreadPool*, size_t>& currentWorker() {
+      static thread_local std::pair<const ThreadPool*, size_t> current(nullptr, 0);
+      return current;
+    }
+
+    std::vector<std::thread> workers_;
+    std::vector<std::unique_ptr<Queue>> queues_;
+    const size_t bound_;
+
+    // tasks added and not yet taken; briefly negative while a task is
+    // taken before its adding thread counted it
+    std::atomic<int64_t> pending_;
+    std::atomic<size_t> nextQueue_;
+
+    // idle workers and callers waiting for a bounded pool sleep here
+    std::mutex sleepMutex_;
+    std::condition_variable condition_;
+    std::condition_variable notFull_;
+    std::atomic<unsigned> sleepers_;
+    std::atomic<unsigned> blocked_;
+    std::atomic<bool> stop_;
+
+    std::atomic<uint64_t> tasks_, steals_, contended_, sleeps_, fullWaits_;
+    std::atomic<uint64_t> waitNs_, maxWaitNs_;
+};
+
+template<class F>
+const ThreadPool::Task::Ops ThreadPool::Task::InlineOps<F>::ops = {
+  &InlineOps<F>::Invoke, &InlineOps<F>::Move, &InlineOps<F>::Destroy
+};
+
+template<class F>
+const ThreadPool::Task::Ops ThreadPool::Task::HeapOps<F>::ops = {
+  &HeapOps<F>::Invoke, &HeapOps<F>::Move, &HeapOps<F>::Destroy
 };
 
 // the constructor just launches some amount of workers
 inline ThreadPool::ThreadPool(size_t threads, size_t in_bound)
-  : stop(false), bound(in_bound) {
-    for (size_t i = 0;i<threads;++i)
-      workers.emplace_back(
-          [this] {
-              for(;;) {
-                  std::function<void()> task;
-                  {
-                    std::unique_lock<std::mutex> lock(this->queue_mutex);
-                    this->condition.wait(lock,
-                        [this]{ return this->stop || !this->tasks.empty(); });
-                    if (this->stop && this->tasks.empty())
-                        return;
-                    task = std::move(this->tasks.front());
-                    this->tasks.pop();
-                  }
-                  this->bounded_condition.notify_one();
-
-                  task();
-              }
-          }
-      );
+  : bound_(in_bound),
+    pending_(0),
+    nextQueue_(0),
+    sleepers_(0),
+    blocked_(0),
+    stop_(false),
+    tasks_(0),
+    steals_(0),
+    contended_(0),
+    sleeps_(0),
+    fullWaits_(0),
+    waitNs_(0),
+    maxWaitNs_(0)
+{
+  for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i) {
+    queues_.emplace_back(new Queue());
+  }
+  for (size_t i = 0; i < threads; ++i) {
+    workers_.emplace_back(&ThreadPool::work, this, i);
+  }
 }
 
 // add new work item to the pool
@@ -99,37 +268,184 @@ auto ThreadPool::enqueue(F&& f, Args&&... args)
 {
   using return_type = typename std::result_of<F(Args...)>::type;
 
-  auto task = std::make_shared< std::packaged_task<return_type()> >(
+  std::packaged_task<return_type()> task(
           std::bind(std::forward<F>(f), std::forward<Args>(args)...)
       );
 
-  std::future<return_type> res = task->get_future();
+  std::future<return_type> res = task.get_future();
+  push(Task(std::move(task)), Priority::Normal);
+  return res;
+}
+
+template<class F>
+void ThreadPool::post(F&& f, Priority priority)
+{
+  push(Task(std::forward<F>(f)), priority);
+}
+
+inline std::unique_lock<std::mutex> ThreadPool::lock(Queue& queue)
+{
+  std::unique_lock<std::mutex> lock(queue.mutex, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    contended_.fetch_add(1, std::memory_order_relaxed);
+    lock.lock();
+  }
+  return lock;
+}
+
+inline void ThreadPool::push(Task&& task, Priority priority)
+{
+  if (bound_) {
+    waitNotFull();
+  }
+  // don't allow enqueueing after stopping the pool
+  if (stop_) {
+    throw std::runtime_error("enqueue on stopped ThreadPool");
+  }
+
+  const auto& current = currentWorker();
+  size_t index = current.first == this ? current.second
+                                        : nextQueue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+  Queue& queue = *queues_[index];
   {
-      std::unique_lock<std::mutex> lock(queue_mutex);
-      this->bounded_condition.wait(lock, [this] { return this->tasks.size() < this->bound || this->bound == 0 || this->stop; });
-      // don't allow enqueueing after stopping the pool
-      if (stop) {
-        throw std::runtime_error("enqueue on stopped ThreadPool");
+    std::unique_lock<std::mutex> queueLock = lock(queue);
+    queue.tasks[int(priority)].push_back(Entry{std::move(task), std::chrono::steady_clock::now()});
+    queue.sizes[int(priority)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // a worker going to sleep counts itself before it checks pending_, so
+  // either it sees this task or it is woken up here
+  ++pending_;
+  if (sleepers_ > 0) {
+    // taking the lock waits until such a worker is waiting, notifying after
+    // it is released saves the worker from blocking on it again
+    { std::lock_guard<std::mutex> sleepLock(sleepMutex_); }
+    condition_.notify_one();
+  }
+}
+
+inline void ThreadPool::waitNotFull()
+{
+  if (pending_ < int64_t(bound_)) {
+    return;
+  }
+  // callers waiting at the same time may each add a task once woken up,
+  // so the bound can be exceeded by that many
+  std::unique_lock<std::mutex> sleepLock(sleepMutex_);
+  ++blocked_;
+  if (pending_ >= int64_t(bound_)) {
+    ++fullWaits_;
+  }
+  notFull_.wait(sleepLock, [this] { return pending_ < int64_t(bound_) || stop_; });
+  --blocked_;
+}
+
+inline bool ThreadPool::pop(size_t worker, Entry& entry)
+{
+  for (int priority = int(Priority::High); priority >= int(Priority::Normal); --priority) {
+    for (size_t i = 0; i < queues_.size(); ++i) {
+      Queue& queue = *queues_[(worker + i) % queues_.size()];
+      if (queue.sizes[priority].load(std::memory_order_relaxed) == 0) {
+        continue;
       }
 
-      tasks.emplace([task](){ (*task)(); });
+      std::unique_lock<std::mutex> queueLock = lock(queue);
+      std::deque<Entry>& tasks = queue.tasks[priority];
+      if (tasks.empty()) {
+        continue;
+      }
+      entry = std::move(tasks.front());
+      tasks.pop_front();
+      queue.sizes[priority].fetch_sub(1, std::memory_order_relaxed);
+      if (i > 0) {
+        steals_.fetch_add(1, std::memory_order_relaxed);
+      }
+      return true;
+    }
   }
-  condition.notify_one();
-  return res;
+  return false;
 }
 
-// the destructor joins all threads
-inline ThreadPool::~ThreadPool() {
+inline void ThreadPool::work(size_t worker)
+{
+  currentWorker() = std::make_pair(this, worker);
+
+  Entry entry;
+  for (;;) {
+    if (pop(worker, entry)) {
+      --pending_;
+      if (bound_ && blocked_ > 0) {
+        { std::lock_guard<std::mutex> sleepLock(sleepMutex_); }
+        notFull_.notify_one();
+      }
+
+      uint64_t waitNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - entry.added).count();
+      waitNs_.fetch_add(waitNs, std::memory_order_relaxed);
+      uint64_t maxWaitNs = maxWaitNs_.load(std::memory_order_relaxed);
+      while (waitNs > maxWaitNs && !maxWaitNs_.compare_exchange_weak(maxWaitNs, waitNs)) {}
+
+      entry.task();
+      // release what the task holds before waiting for the next one
+      entry.task.reset();
+      tasks_.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> sleepLock(sleepMutex_);
+    ++sleepers_;
+    if (pending_ <= 0 && !stop_) {
+      sleeps_.fetch_add(1, std::memory_order_relaxed);
+      condition_.wait(sleepLock, [this] { return pending_ > 0 || stop_; });
+    }
+    --sleepers_;
+    if (stop_ && pending_ <= 0) {
+      return;
+    }
+  }
+}
+
+inline void ThreadPool::stop()
+{
   {
-      std::unique_lock<std::mutex> lock(queue_mutex);
-      stop = true;
+    std::lock_guard<std::mutex> sleepLock(sleepMutex_);
+    stop_ = true;
   }
-  bounded_condition.notify_all();
-  condition.notify_all();
-  for (std::thread &worker: workers) {
-    worker.join();
+  notFull_.notify_all();
+  condition_.notify_all();
+  for (std::thread &worker: workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
   }
 }
 
+// the destructor joins all threads
+inline ThreadPool::~ThreadPool()
+{
+  stop();
 }
 
+inline ThreadPool::Stats ThreadPool::getStats() const
+{
+  Stats stats;
+  stats.tasks = tasks_;
+  stats.steals = steals_;
+  stats.contended = contended_;
+  stats.sleeps = sleeps_;
+  stats.fullWaits = fullWaits_;
+  stats.meanWaitUs = stats.tasks ? waitNs_ / 1000.0 / stats.tasks : 0.0;
+  stats.maxWaitUs = maxWaitNs_ / 1000.0;
+  return stats;
+}
+
+inline void ThreadPool::logStats(const std::string& name) const
+{
+  Stats stats = getStats();
+  LOG(info)->info("Pool {}: {} tasks, {} stolen, {} contended locks, idle {} times, "
+                  "full {} times, mean wait {:.1f}us, max wait {:.1f}us",
+                  name, stats.tasks, stats.steals, stats.contended, stats.sleeps,
+                  stats.fullWaits, stats.meanWaitUs, stats.maxWaitUs);
+}
+
+}
@@ -0,0 +1,180 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <queue>
+
+#include "common/threadpool.h"
+
+using namespace amunmt;
+
+namespace {
+
+// The pool this replaced: one queue behind one mutex, every task a
+// packaged_task in a shared_ptr in a std::function.
+class LegacyThreadPool {
+ public:
+    explicit LegacyThreadPool(size_t threads, size_t bound /* bound on size, or 0 for unbounded */ = 0);
+
+    template<class F, class... Args>
+    auto enqueue(F&& f, Args&&... args)
+        -> std::future<typename std::result_of<F(Args...)>::type>;
+    ~LegacyThreadPool();
+
+    size_t getNumTasks() const {
+      return tasks.size();
+    }
+
+ private:
+    // need to keep track of threads so we can join them
+    std::vector<std::thread> workers;
+    // the task queue
+    std::queue< std::function<void()> > tasks;
+
+    // synchronization
+    std::mutex queue_mutex;
+    std::condition_variable condition;
+    std::size_t bound;
+    std::condition_variable bounded_condition;
+    bool stop;
+};
+
+// the constructor just launches some amount of workers
+inline LegacyThreadPool::LegacyThreadPool(size_t threads, size_t in_bound)
+  : stop(false), bound(in_bound) {
+    for (size_t i = 0;i<threads;++i)
+      workers.emplace_back(
+          [this] {
+              for(;;) {
+                  std::function<void()> task;
+                  {
+                    std::unique_lock<std::mutex> lock(this->queue_mutex);
+                    this->condition.wait(lock,
+                        [this]{ return this->stop || !this->tasks.empty(); });
+                    if (this->stop && this->tasks.empty())
+                        return;
+                    task = std::move(this->tasks.front());
+                    this->tasks.pop();
+                  }
+                  this->bounded_condition.notify_one();
+
+                  task();
+              }
+          }
+      );
+}
+
+// add new work item to the pool
+template<class F, class... Args>
+auto LegacyThreadPool::enqueue(F&& f, Args&&... args)
+    -> std::future<typename std::result_of<F(Args...)>::type>
+{
+  using return_type = typename std::result_of<F(Args...)>::type;
+
+  auto task = std::make_shared< std::packaged_task<return_type()> >(
+          std::bind(std::forward<F>(f), std::forward<Args>(args)...)
+      );
+
+  std::future<return_type> res = task->get_future();
+  {
+      std::unique_lock<std::mutex> lock(queue_mutex);
+      this->bounded_condition.wait(lock, [this] { return this->tasks.size() < this->bound || this->bound == 0 || this->stop; });
+      // don't allow enqueueing after stopping the pool
+      if (stop) {
+        throw std::runtime_error("enqueue on stopped LegacyThreadPool");
+      }
+
+      tasks.emplace([task](){ (*task)(); });
+  }
+  condition.notify_one();
+  return res;
+}
+
+// the destructor joins all threads
+inline LegacyThreadPool::~LegacyThreadPool() {
+  {
+      std::unique_lock<std::mutex> lock(queue_mutex);
+      stop = true;
+  }
+  bounded_condition.notify_all();
+  condition.notify_all();
+  for (std::thread &worker: workers) {
+    worker.join();
+  }
+}
+
+struct Result {
+  double seconds;
+  double meanWaitUs;
+};
+
+// Posts tasks from several threads at once. Each task spins for about
+// workNs and adds the time from its posting until its start.
+template <class Post>
+Result Run(unsigned producers, unsigned tasks, unsigned workNs, Post post) {
+  std::atomic<uint64_t> waitNs(0);
+  std::atomic<unsigned> done(0);
+  auto task = [&waitNs, &done, workNs](std::chrono::steady_clock::time_point posted) {
+    auto start = std::chrono::steady_clock::now();
+    waitNs += std::chrono::duration_cast<std::chrono::nanoseconds>(start - posted).count();
+    while (std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - start).count() < workNs) {}
+    ++done;
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (unsigned p = 0; p < producers; ++p) {
+    threads.emplace_back([&, p]() {
+      for (unsigned i = p; i < tasks; i += producers) {
+        auto posted = std::chrono::steady_clock::now();
+        post([task, posted]() { task(posted); });
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  while (done < tasks) {
+    std::this_thread::yield();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return Result{elapsed.count(), waitNs / 1000.0 / tasks};
+}
+
+}
+
+// Many small tasks posted by several threads to the old and the new pool,
+// bounded by the number of workers like the translation pool.
+int main(int argc, char** argv) {
+  if (argc > 3) {
+    std::cerr << "Usage: " << argv[0] << " [tasks=200000] [work-ns=1000]" << std::endl;
+    return 1;
+  }
+  unsigned tasks = argc > 1 ? std::atoi(argv[1]) : 200000;
+  unsigned workNs = argc > 2 ? std::atoi(argv[2]) : 1000;
+
+  std::cout << "workers\tproducers\told tasks/s\told wait us\tnew tasks/s\tnew wait us"
+            << "\tspeedup\tsteals\tcontended" << std::endl;
+  for (unsigned workers : {1, 2, 4, 8}) {
+    for (unsigned producers : {1, 4}) {
+      Result legacy;
+      {
+        LegacyThreadPool pool(workers, workers);
+        legacy = Run(producers, tasks, workNs, [&pool](auto&& f) { pool.enqueue(std::forward<decltype(f)>(f)); });
+      }
+
+      ThreadPool pool(workers, workers);
+      Result current = Run(producers, tasks, workNs, [&pool](auto&& f) { pool.post(std::forward<decltype(f)>(f)); });
+      pool.stop();
+      ThreadPool::Stats stats = pool.getStats();
+
+      std::cout << workers << "\t" << producers
+                << "\t" << tasks / legacy.seconds << "\t" << legacy.meanWaitUs
+                << "\t" << tasks / current.seconds << "\t" << current.meanWaitUs
+                << "\t" << legacy.seconds / current.seconds << "x"
+                << "\t" << stats.steals << "\t" << stats.contended << std::endl;
+    }
+  }
+  return 0;
+}
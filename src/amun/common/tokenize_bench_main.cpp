@@ -0,0 +1,110 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+#include "common/factor_vocab.h"
+#include "common/utils.h"
+
+using namespace amunmt;
+
+namespace {
+
+// What Sentence did before: every tab, token and factor copied into its
+// own string, the whole line copied once more for the preprocessors, then
+// every factor looked up
+std::vector<FactWords> CopyingTokenize(const FactorVocab& vocab, const std::string& line) {
+  std::vector<FactWords> factors;
+  std::vector<std::string> tabs;
+  Split(line, tabs, "\t");
+  if (tabs.size() == 0) {
+    tabs.push_back("");
+  }
+  for (auto& tab : tabs) {
+    std::vector<std::string> lineTokens;
+    Trim(tab);
+    Split(tab, lineTokens, " ");
+
+    std::vector<std::vector<std::string>> lineFactors;
+    for (const std::string& token : lineTokens) {
+      std::vector<std::string> wordFactors;
+      Split(token, wordFactors, "|");
+      lineFactors.push_back(wordFactors);
+    }
+    std::vector<std::vector<std::string>> processed = lineFactors;
+    factors.emplace_back(vocab(processed));
+  }
+  return factors;
+}
+
+std::vector<FactWords> ViewTokenize(const FactorVocab& vocab, const std::string& line) {
+  std::vector<FactWords> factors;
+  std::vector<boost::string_view> tabs, lineTokens;
+  Split(line, tabs, '\t');
+  if (tabs.size() == 0) {
+    tabs.push_back(boost::string_view());
+  }
+  for (auto tab : tabs) {
+    lineTokens.clear();
+    Split(Trim(tab), lineTokens, ' ');
+    factors.emplace_back(vocab(lineTokens));
+  }
+  return factors;
+}
+
+template <class F>
+double Seconds(F f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+}
+
+// Turns every line of a text into factor ids the way Sentence did before
+// and the way it does now, without preprocessors. Checks both agree.
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0] << " text vocab [factor-vocab ...]" << std::endl;
+    return 1;
+  }
+
+  std::vector<std::string> lines;
+  size_t bytes = 0;
+  {
+    std::ifstream text(argv[1]);
+    std::string line;
+    while (std::getline(text, line)) {
+      bytes += line.size() + 1;
+      lines.push_back(std::move(line));
+    }
+  }
+  FactorVocab vocab(std::vector<std::string>(argv + 2, argv + argc));
+
+  size_t mismatches = 0;
+  for (const auto& line : lines) {
+    if (CopyingTokenize(vocab, line) != ViewTokenize(vocab, line)) {
+      ++mismatches;
+    }
+  }
+
+  size_t ids = 0;
+  double copyingTime = Seconds([&]() {
+    for (const auto& line : lines) {
+      ids += CopyingTokenize(vocab, line)[0].size();
+    }
+  });
+  double viewTime = Seconds([&]() {
+    for (const auto& line : lines) {
+      ids += ViewTokenize(vocab, line)[0].size();
+    }
+  });
+
+  std::cout << lines.size() << " lines, " << mismatches << " mismatches" << std::endl;
+  std::cout << "MB/s: copying " << bytes / copyingTime / 1e6
+            << ", views " << bytes / viewTime / 1e6
+            << ", speedup " << copyingTime / viewTime << "x" << std::endl;
+  std::cerr << ids << " ids" << std::endl;
+
+  return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,164 @@
+#include "translation_cache.h"
+
+#include <functional>
+#include <sstream>
+
+#include "common/god.h"
+#include "common/logging.h"
+#include "common/sentence.h"
+
+using namespace std;
+
+namespace amunmt {
+
+namespace {
+
+const size_t NUM_SHARDS = 16;
+
+size_t ConfigHash(const God &god) {
+  std::stringstream config;
+  config << god.Get("scorers") << "\n";
+  for (auto& weight : god.GetScorerWeights()) {
+    config << weight.first << "=" << weight.second << "\n";
+  }
+  for (const char* key : {"beam-size", "normalize", "n-best", "allow-unk", "softmax-filter",
+                          "max-length", "max-length-factor", "no-early-stop",
+                          "prune-relative", "prune-absolute", "no-debpe", "wipo",
+                          "return-alignment", "return-soft-alignment"}) {
+    config << key << "=" << god.Get(key) << "\n";
+  }
+  return std::hash<std::string>()(config.str());
+}
+
+}
+
+TranslationCache::TranslationCache(const God &god, size_t maxBytes)
+  : configHash_(ConfigHash(god)),
+    nbest_(god.GetOptions().nBest),
+    maxShardBytes_(maxBytes / NUM_SHARDS),
+    shards_(NUM_SHARDS),
+    hits_(0),
+    misses_(0),
+    evictions_(0)
+{}
+
+size_t TranslationCache::KeyHash::operator()(const Key& key) const {
+  size_t hash = key.size();
+  for (Word word : key) {
+    hash ^= word + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+  }
+  return hash;
+}
+
+// The configuration hash, then per tab the number of words and per word
+// its factors
+TranslationCache::Key TranslationCache::MakeKey(const Sentence& sentence) const {
+  Key key;
+  key.push_back(configHash_);
+  key.push_back(configHash_ >> 32);
+  for (unsigned tab = 0; tab < sentence.GetNumTabs(); ++tab) {
+    const FactWords& factors = sentence.GetFactors(tab);
+    key.push_back(factors.size());
+    for (const FactWord& word : factors) {
+      key.push_back(word.size());
+      key.insert(key.end(), word.begin(), word.end());
+    }
+  }
+  return key;
+}
+
+TranslationCache::Shard& TranslationCache::GetShard(const Key& key) {
+  return shards_[KeyHash()(key) % shards_.size()];
+}
+
+bool TranslationCache::Get(const Sentence& sentence, std::string& output) {
+  Key key = MakeKey(sentence);
+  Shard& shard = GetShard(key);
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.index.find(key);
+    if (found == shard.index.end()) {
+      ++misses_;
+      return false;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+
+    const Entry& entry = *found->second;
+    output = entry.output;
+    if (nbest_ && entry.lineNum != sentence.GetLineNum()) {
+      output = Renumber(output, entry.lineNum, sentence.GetLineNum());
+    }
+  }
+  ++hits_;
+  return true;
+}
+
+void TranslationCache::Put(const Sentence& sentence, const std::string& output) {
+  Key key = MakeKey(sentence);
+  // list and map nodes come on top of the key and the text
+  size_t bytes = sizeof(Entry) + 64 + key.size() * sizeof(Word) + output.size();
+  if (bytes > maxShardBytes_) {
+    return;
+  }
+
+  Shard& shard = GetShard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  if (shard.index.count(key)) {
+    return;
+  }
+
+  shard.lru.push_front(Entry{key, output, sentence.GetLineNum(), bytes});
+  shard.index.emplace(std::move(key), shard.lru.begin());
+  shard.bytes += bytes;
+
+  while (shard.bytes > maxShardBytes_) {
+    const Entry& last = shard.lru.back();
+    shard.bytes -= last.bytes;
+    shard.index.erase(last.key);
+    shard.lru.pop_back();
+    ++evictions_;
+  }
+}
+
+// n-best lines start with the line number, after "OUT: " for WIPO
+std::string TranslationCache::Renumber(const std::string& output, unsigned from, unsigned to) const {
+  const std::string oldPrefix = std::to_string(from) + " ||| ";
+  const std::string newPrefix = std::to_string(to) + " ||| ";
+
+  std::string ret;
+  size_t start = 0;
+  while (start < output.size()) {
+    size_t end = output.find('\n', start);
+    if (end == std::string::npos) {
+      end = output.size();
+    } else {
+      ++end;
+    }
+
+    size_t numPos = output.compare(start, 5, "OUT: ") == 0 ? start + 5 : start;
+    ret.append(output, start, numPos - start);
+    if (output.compare(numPos, oldPrefix.size(), oldPrefix) == 0) {
+      ret += newPrefix;
+      numPos += oldPrefix.size();
+    }
+    ret.append(output, numPos, end - numPos);
+    start = end;
+  }
+  return ret;
+}
+
+void TranslationCache::LogStats() {
+  size_t entries = 0, bytes = 0;
+  for (Shard& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    entries += shard.lru.size();
+    bytes += shard.bytes;
+  }
+  size_t lookups = hits_ + misses_;
+  LOG(info)->info("Translation cache: {} hits, {} misses ({:.1f}% hit rate), {} entries, "
+                  "{:.1f} MB, {} evicted",
+                  hits_.load(), misses_.load(), lookups ? 100.0 * hits_ / lookups : 0.0,
+                  entries, bytes / 1048576.0, evictions_.load());
+}
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/types.h"
+
+namespace amunmt {
+
+class God;
+class Sentence;
+
+// Printed translations of source sentences seen before, keyed by their
+// preprocessed words and factors together with a hash of the options that
+// change the output: scorers, weights and search settings. Split into
+// shards, each with its own lock and least recently used list, so the
+// translation threads rarely wait for each other. A shard drops its least
+// recently used entries once it holds more than its share of the memory
+// cap.
+class TranslationCache {
+  public:
+    TranslationCache(const God &god, size_t maxBytes);
+
+    // The translation of sentence as Printer would print it, with n-best
+    // line numbers changed to the sentence's own, if there is one.
+    bool Get(const Sentence& sentence, std::string& output);
+
+    // output is what Printer printed for sentence
+    void Put(const Sentence& sentence, const std::string& output);
+
+    void LogStats();
+
+  private:
+    typedef std::vector<Word> Key;
+
+    struct KeyHash {
+      size_t operator()(const Key& key) const;
+    };
+
+    struct Entry {
+      Key key;
+      std::string output;
+      unsigned lineNum;
+      size_t bytes;
+    };
+
+    struct Shard {
+      std::mutex mutex;
+      std::list<Entry> lru; // most recently used first
+      std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+      size_t bytes = 0;
+    };
+
+    Key MakeKey(const Sentence& sentence) const;
+    Shard& GetShard(const Key& key);
+    std::string Renumber(const std::string& output, unsigned from, unsigned to) const;
+
+    const size_t configHash_;
+    const bool nbest_;
+    const size_t maxShardBytes_;
+    std::vector<Shard> shards_;
+
+    std::atomic<size_t> hits_;
+    std::atomic<size_t> misses_;
+    std::atomic<size_t> evictions_;
+
+    TranslationCache(const TranslationCache&) = delete;
+};
+
+}
@@ -28,6 +28,9 @@ void TranslationTaskAndOutput(const God &god, std::shared_ptr<Sentences> sentenc
     std::stringstream strm;
     Printer(god, history, strm, sentence);
 
+    if (TranslationCache* cache = god.GetTranslationCache()) {
+      cache->Put(sentences->Get(i), strm.str());
+    }
     outputCollector.Write(lineNum, strm.str());
   }
 }
@@ -6,7 +6,8 @@ namespace amunmt {
 
 std::ostream& operator<<(std::ostream& out, const DeviceInfo& obj)
 {
-  out << obj.deviceType << " t=" << obj.threadInd << " d=" << obj.deviceId;
+  out << obj.deviceType << " t=" << obj.threadInd << " d=" << obj.deviceId
+      << " n=" << obj.numaNode << " c=" << obj.cpu;
   return out;
 }
 
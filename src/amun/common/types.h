@@ -34,6 +34,10 @@ struct DeviceInfo
   DeviceType deviceType;
   unsigned threadInd;
   unsigned deviceId;
+  // CPU threads: the NUMA node whose model replica they use, and the CPU
+  // they are pinned to, -1 for none
+  unsigned numaNode = 0;
+  int cpu = -1;
 };
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -29,6 +29,29 @@ void Split(const std::string& line, std::vector<std::string>& pieces, const std:
     pieces.push_back(token);
 }
 
+boost::string_view Trim(boost::string_view s) {
+  size_t begin = s.find_first_not_of(" \t\n");
+  if (begin == boost::string_view::npos) {
+    return boost::string_view();
+  }
+  size_t end = s.find_last_not_of(" \t\n");
+  return s.substr(begin, end + 1 - begin);
+}
+
+void Split(boost::string_view line, std::vector<boost::string_view>& pieces, char del) {
+  size_t begin = 0;
+  size_t pos;
+  while ((pos = line.find(del, begin)) != boost::string_view::npos) {
+    if (pos > begin) {
+      pieces.push_back(line.substr(begin, pos - begin));
+    }
+    begin = pos + 1;
+  }
+  if (line.size() > begin) {
+    pieces.push_back(line.substr(begin));
+  }
+}
+
 std::string Join(const std::vector<std::string>& words, const std::string del) {
   std::stringstream ss;
   if (words.empty()) {
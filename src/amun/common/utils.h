@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <boost/algorithm/string.hpp>
+#include <boost/utility/string_view.hpp>
 
 namespace amunmt {
 
@@ -10,6 +11,10 @@ void Trim(std::string& s);
 
 void Split(const std::string& line, std::vector<std::string>& pieces, const std::string del=" ");
 
+// Same as above without copies, the pieces point into line
+boost::string_view Trim(boost::string_view s);
+void Split(boost::string_view line, std::vector<boost::string_view>& pieces, char del=' ');
+
 std::string Join(const std::vector<std::string>& words, const std::string del=" ");
 std::string Join(const std::vector<std::string>& words,
                  const std::vector<size_t>& align, const std::string del=" ");
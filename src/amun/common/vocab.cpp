@@ -1,6 +1,12 @@
 #include "common/vocab.h"
 
+#include <cstring>
+#include <fstream>
 #include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <yaml-cpp/yaml.h>
 
 #include "common/utils.h"
@@ -11,27 +17,187 @@ using namespace std;
 
 namespace amunmt {
 
+namespace {
+
+const char VOCAB_MAGIC[8] = {'A', 'M', 'U', 'N', 'V', 'O', 'C', '1'};
+const size_t HEADER_WORDS = 4;
+
+// FNV-1a, fixed here because the hashes are stored in binary vocabularies
+uint64_t Hash(boost::string_view word) {
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : word) {
+    hash = (hash ^ (unsigned char)c) * 1099511628211ull;
+  }
+  return hash;
+}
+
+size_t Words64(size_t bytes) {
+  return (bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+}
+
+}
+
 Vocab::Vocab(const std::string& path) {
-    YAML::Node vocab = YAML::Load(InputFileStream(path));
-    for(auto&& pair : vocab) {
-      auto str = pair.first.as<std::string>();
-      auto id = pair.second.as<Word>();
-      str2id_[str] = id;
-      if(id >= id2str_.size())
-        id2str_.resize(id + 1);
-      id2str_[id] = str;
+  if (IsBinary(path)) {
+    Map(path);
+    return;
+  }
+
+  std::vector<std::pair<std::string, Word>> entries;
+  YAML::Node vocab = YAML::Load(InputFileStream(path));
+  for(auto&& pair : vocab) {
+    entries.emplace_back(pair.first.as<std::string>(), pair.second.as<Word>());
+  }
+  amunmt_UTIL_THROW_IF2(entries.empty(), "Empty vocabulary " << path);
+  Build(entries);
+}
+
+// Lays out the binary image: header, id offsets, key offsets, key ids,
+// hash table, blob. The 64-bit arrays come first so all stay aligned.
+void Vocab::Build(const std::vector<std::pair<std::string, Word>>& entries) {
+  std::vector<std::string> id2str;
+  for (const auto& entry : entries) {
+    if (entry.second >= id2str.size())
+      id2str.resize(entry.second + 1);
+    id2str[entry.second] = entry.first;
+  }
+  if (id2str.size() <= UNK_ID)
+    id2str.resize(UNK_ID + 1);
+  id2str[EOS_ID] = EOS_STR;
+  id2str[UNK_ID] = UNK_STR;
+
+  uint64_t tableSize = 1;
+  while (tableSize < 2 * entries.size())
+    tableSize *= 2;
+
+  uint64_t blobSize = 0;
+  for (const auto& str : id2str)
+    blobSize += str.size();
+  for (const auto& entry : entries)
+    blobSize += entry.first.size();
+
+  const uint64_t size = id2str.size(), numKeys = entries.size();
+  image_.assign(1 + HEADER_WORDS + (size + 1) + (numKeys + 1)
+                + Words64((numKeys + tableSize) * sizeof(uint32_t)) + Words64(blobSize), 0);
+  char* data = reinterpret_cast<char*>(image_.data());
+  std::copy(VOCAB_MAGIC, VOCAB_MAGIC + sizeof(VOCAB_MAGIC), data);
+  uint64_t* header = image_.data() + 1;
+  header[0] = size;
+  header[1] = numKeys;
+  header[2] = tableSize;
+  header[3] = blobSize;
+
+  uint64_t* idOffsets = header + HEADER_WORDS;
+  uint64_t* keyOffsets = idOffsets + size + 1;
+  uint32_t* keyIds = reinterpret_cast<uint32_t*>(keyOffsets + numKeys + 1);
+  uint32_t* table = keyIds + numKeys;
+  char* blob = reinterpret_cast<char*>(table + tableSize);
+
+  uint64_t offset = 0;
+  for (uint64_t i = 0; i < size; ++i) {
+    idOffsets[i] = offset;
+    std::copy(id2str[i].begin(), id2str[i].end(), blob + offset);
+    offset += id2str[i].size();
+  }
+  idOffsets[size] = offset;
+
+  for (uint64_t i = 0; i < numKeys; ++i) {
+    const std::string& word = entries[i].first;
+    keyOffsets[i] = offset;
+    keyIds[i] = entries[i].second;
+    std::copy(word.begin(), word.end(), blob + offset);
+    offset += word.size();
+  }
+  keyOffsets[numKeys] = offset;
+
+  for (uint64_t i = 0; i < numKeys; ++i) {
+    boost::string_view word(blob + keyOffsets[i], keyOffsets[i + 1] - keyOffsets[i]);
+    uint64_t slot = Hash(word) & (tableSize - 1);
+    while (table[slot]) {
+      uint32_t other = table[slot] - 1;
+      // a later duplicate wins, as it did with a map
+      if (word == boost::string_view(blob + keyOffsets[other], keyOffsets[other + 1] - keyOffsets[other]))
+        break;
+      slot = (slot + 1) & (tableSize - 1);
     }
-    amunmt_UTIL_THROW_IF2(id2str_.empty(), "Empty vocabulary " << path);
-    id2str_[EOS_ID] = EOS_STR;
-    id2str_[UNK_ID] = UNK_STR;
+    table[slot] = i + 1;
+  }
+
+  Attach(data, image_.size() * sizeof(uint64_t), "vocabulary");
+}
+
+void Vocab::Attach(const char* data, size_t size, const std::string& path) {
+  const size_t headerBytes = (1 + HEADER_WORDS) * sizeof(uint64_t);
+  amunmt_UTIL_THROW_IF2(size < headerBytes, "Truncated vocabulary " << path);
+  const uint64_t* header = reinterpret_cast<const uint64_t*>(data) + 1;
+  size_ = header[0];
+  numKeys_ = header[1];
+  const uint64_t tableSize = header[2];
+  blobSize_ = header[3];
+  tableMask_ = tableSize - 1;
+
+  const size_t expected = headerBytes + (size_ + 1 + numKeys_ + 1) * sizeof(uint64_t)
+                          + (numKeys_ + tableSize) * sizeof(uint32_t) + blobSize_;
+  amunmt_UTIL_THROW_IF2(size < expected || tableSize <= numKeys_ || (tableSize & tableMask_),
+                        "Corrupt vocabulary " << path);
+
+  idOffsets_ = header + HEADER_WORDS;
+  keyOffsets_ = idOffsets_ + size_ + 1;
+  keyIds_ = reinterpret_cast<const uint32_t*>(keyOffsets_ + numKeys_ + 1);
+  table_ = keyIds_ + numKeys_;
+  blob_ = reinterpret_cast<const char*>(table_ + tableSize);
+  amunmt_UTIL_THROW_IF2(size_ <= UNK_ID || idOffsets_[size_] > blobSize_
+                        || keyOffsets_[numKeys_] > blobSize_,
+                        "Corrupt vocabulary " << path);
+
+  data_ = data;
+  dataSize_ = size;
+}
+
+bool Vocab::IsBinary(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  char magic[sizeof(VOCAB_MAGIC)];
+  return in.read(magic, sizeof(magic))
+      && std::memcmp(magic, VOCAB_MAGIC, sizeof(VOCAB_MAGIC)) == 0;
+}
+
+void Vocab::Map(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  amunmt_UTIL_THROW_IF2(fd < 0, "Cannot open " << path);
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    amunmt_UTIL_THROW2("Cannot stat " << path);
+  }
+  size_t size = st.st_size;
+
+  void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  amunmt_UTIL_THROW_IF2(addr == MAP_FAILED, "Cannot memory-map " << path);
+  mapping_.reset(addr, [size](const void* p) { munmap(const_cast<void*>(p), size); });
+
+  Attach(static_cast<const char*>(addr), size, path);
+}
+
+void Vocab::WriteBinary(const std::string& path) const {
+  std::ofstream out(path, std::ios::binary);
+  out.write(data_, dataSize_);
+  amunmt_UTIL_THROW_IF2(!out, "Cannot write " << path);
+}
+
+boost::string_view Vocab::Key(uint32_t key) const {
+  return boost::string_view(blob_ + keyOffsets_[key], keyOffsets_[key + 1] - keyOffsets_[key]);
 }
 
-unsigned Vocab::operator[](const std::string& word) const {
-    auto it = str2id_.find(word);
-    if(it != str2id_.end())
-        return it->second;
-    else
-        return UNK_ID;
+unsigned Vocab::operator[](boost::string_view word) const {
+  uint64_t slot = Hash(word) & tableMask_;
+  while (uint32_t entry = table_[slot]) {
+    if (Key(entry - 1) == word)
+      return keyIds_[entry - 1];
+    slot = (slot + 1) & tableMask_;
+  }
+  return UNK_ID;
 }
 
 Words Vocab::operator()(const std::vector<std::string>& lineTokens, bool addEOS) const {
@@ -44,29 +210,35 @@ Words Vocab::operator()(const std::vector<std::string>& lineTokens, bool addEOS)
 }
 
 Words Vocab::operator()(const std::string& line, bool addEOS) const {
-  std::vector<std::string> lineTokens;
-  Split(line, lineTokens, " ");
-  return (*this)(lineTokens, addEOS);
+  std::vector<boost::string_view> lineTokens;
+  Split(line, lineTokens, ' ');
+  Words words(lineTokens.size());
+  for (size_t i = 0; i < lineTokens.size(); ++i) {
+    words[i] = (*this)[lineTokens[i]];
+  }
+  if(addEOS)
+    words.push_back(EOS_ID);
+  return words;
 }
 
 std::vector<std::string> Vocab::operator()(const Words& sentence, bool ignoreEOS) const {
   std::vector<std::string> decoded;
   for(unsigned i = 0; i < sentence.size(); ++i) {
     if(sentence[i] != EOS_ID || !ignoreEOS) {
-      decoded.push_back((*this)[sentence[i]]);
+      decoded.push_back((*this)[sentence[i]].to_string());
     }
   }
   return decoded;
 }
 
 
-const std::string& Vocab::operator[](unsigned id) const {
-  amunmt_UTIL_THROW_IF2(id >= id2str_.size(), "Unknown word id: " << id);
-  return id2str_[id];
+boost::string_view Vocab::operator[](unsigned id) const {
+  amunmt_UTIL_THROW_IF2(id >= size_, "Unknown word id: " << id);
+  return boost::string_view(blob_ + idOffsets_[id], idOffsets_[id + 1] - idOffsets_[id]);
 }
 
 unsigned Vocab::size() const {
-  return id2str_.size();
+  return size_;
 }
 
 }
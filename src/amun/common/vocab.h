@@ -1,18 +1,24 @@
 #pragma once
 
-#include <map>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
+#include <boost/utility/string_view.hpp>
 
 #include "common/types.h"
 
 namespace amunmt {
 
+// Word <-> id mapping. Loaded from a YAML or JSON file, or memory-mapped
+// from the binary format WriteBinary saves. Either way all strings live in
+// one blob, with an open-addressing hash table from words to ids, so
+// lookups allocate nothing.
 class Vocab {
   public:
     Vocab(const std::string& path);
 
-    unsigned operator[](const std::string& word) const;
+    unsigned operator[](boost::string_view word) const;
 
     Words operator()(const std::vector<std::string>& lineTokens, bool addEOS = true) const;
 
@@ -20,17 +26,42 @@ class Vocab {
 
     std::vector<std::string> operator()(const Words& sentence, bool ignoreEOS = true) const;
 
-    const std::string& operator[](unsigned id) const;
+    boost::string_view operator[](unsigned id) const;
 
     unsigned size() const;
 
+    static bool IsBinary(const std::string& path);
+
+    void WriteBinary(const std::string& path) const;
+
   private:
-    typedef std::map<std::string, unsigned> Str2Id;
-    Str2Id str2id_;
+    void Build(const std::vector<std::pair<std::string, Word>>& entries);
+    void Map(const std::string& path);
+    void Attach(const char* data, size_t size, const std::string& path);
+
+    boost::string_view Key(uint32_t key) const;
+
+    // the binary image, owned by image_ or by mapping_
+    const char* data_;
+    size_t dataSize_;
+    std::vector<uint64_t> image_;
+    std::shared_ptr<const void> mapping_;
 
-    typedef std::vector<std::string> Id2Str;
-    Id2Str id2str_;
+    uint64_t size_;
+    uint64_t numKeys_;
+    uint64_t tableMask_;
+    // string of id i is blob_[idOffsets_[i]] up to blob_[idOffsets_[i + 1]]
+    const uint64_t* idOffsets_;
+    // the words looked up, with their ids; usually the same strings but
+    // EOS and UNK are printed as </s> and <unk> whatever the file says
+    const uint64_t* keyOffsets_;
+    const uint32_t* keyIds_;
+    // key index + 1 at the slot of its hash or after, 0 for empty slots
+    const uint32_t* table_;
+    const char* blob_;
+    uint64_t blobSize_;
 
+    Vocab(const Vocab&) = delete;
 };
 
 }
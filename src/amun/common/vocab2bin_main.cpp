@@ -0,0 +1,15 @@
+#include <iostream>
+
+#include "common/vocab.h"
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " vocab.yml vocab.bin" << std::endl;
+    std::cerr << "Converts a YAML or JSON vocabulary to the binary format amun can memory-map." << std::endl;
+    return 1;
+  }
+
+  amunmt::Vocab vocab(argv[1]);
+  vocab.WriteBinary(argv[2]);
+  return 0;
+}
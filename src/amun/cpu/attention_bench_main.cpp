@@ -0,0 +1,82 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include "cpu/mblas/tensor.h"
+
+using namespace amunmt::CPU;
+
+namespace {
+
+template <class F>
+double Microseconds(F f, unsigned iterations) {
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < iterations; ++i) {
+    f();
+  }
+  std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+void Randomize(mblas::Tensor& t, std::mt19937& gen) {
+  std::normal_distribution<float> normal(0.0f, 0.5f);
+  for (unsigned i = 0; i < t.rows(); ++i) {
+    for (unsigned j = 0; j < t.columns(); ++j) {
+      t(i, j) = normal(gen);
+    }
+  }
+}
+
+}
+
+// Times the attention scores of one decoder step, broadcast tanh followed
+// by a product with V as before, against the fused kernel, for a range of
+// source lengths and beam sizes.
+int main(int argc, char** argv) {
+  if (argc > 3) {
+    std::cerr << "Usage: " << argv[0] << " [dim=1024] [iterations=50]" << std::endl;
+    return 1;
+  }
+  unsigned dim = argc > 1 ? std::atoi(argv[1]) : 1024;
+  unsigned iterations = argc > 2 ? std::atoi(argv[2]) : 50;
+
+  std::mt19937 gen(1234);
+  mblas::Tensor V(1, dim);
+  Randomize(V, gen);
+  mblas::ColumnVector v = blaze::trans(blaze::row(V, 0));
+
+  std::cout << "dim " << dim << std::endl;
+  std::cout << "words\tbeam\tbroadcast us\tfused us\tspeedup\tmax diff" << std::endl;
+  for (unsigned words : {10, 25, 50, 100}) {
+    for (unsigned beam : {1, 5, 12}) {
+      mblas::Tensor keys(words, dim);
+      mblas::Tensor queries(beam, dim);
+      Randomize(keys, gen);
+      Randomize(queries, gen);
+
+      mblas::Tensor temp;
+      mblas::ColumnVector e;
+      double broadcastTime = Microseconds([&]() {
+        temp = mblas::Broadcast<mblas::Tensor>(mblas::Tanh(), keys, queries);
+        e = temp * v;
+      }, iterations);
+
+      mblas::Tensor scores(beam, words);
+      double fusedTime = Microseconds([&]() {
+        mblas::AdditiveAttention(scores, keys, queries, v);
+      }, iterations);
+
+      float maxDiff = 0.0f;
+      for (unsigned j = 0; j < beam; ++j) {
+        for (unsigned k = 0; k < words; ++k) {
+          maxDiff = std::max(maxDiff, std::abs(scores(j, k) - e[j * words + k]));
+        }
+      }
+
+      std::cout << words << "\t" << beam << "\t" << broadcastTime << "\t" << fusedTime
+                << "\t" << broadcastTime / fusedTime << "x\t" << maxDiff << std::endl;
+    }
+  }
+  return 0;
+}
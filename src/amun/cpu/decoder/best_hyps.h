@@ -1,7 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <functional>
 #include <vector>
-#include <boost/iterator/permutation_iterator.hpp>
 
 #include "common/scorer.h"
 #include "common/god.h"
@@ -12,27 +13,20 @@
 namespace amunmt {
 namespace CPU {
 
-struct ProbCompare {
-  ProbCompare(const float* data) : data_(data) {}
-
-  bool operator()(const unsigned a, const unsigned b) {
-    return data_[a] > data_[b];
-  }
-
-  const float* data_;
-};
-
 class BestHyps : public BaseBestHyps
 {
   public:
     BestHyps(const God &god)
-      : BaseBestHyps(god)
+      : BaseBestHyps(god),
+        doSoftmax_(god.GetOptions().beamSize > 1 || god.ReturnNBestList()),
+        greedy_(CPUEncoderDecoderBase::UseGreedy(god))
     {}
 
     void CalcBeam(
         const Beam& prevHyps,
         const std::vector<ScorerPtr>& scorers,
         const Words& filterIndices,
+        HypothesisArena& arena,
         std::vector<Beam>& beams,
         std::vector<unsigned>& beamSizes)
     {
@@ -40,107 +34,199 @@ class BestHyps : public BaseBestHyps
 
       mblas::ArrayMatrix& Probs = static_cast<mblas::ArrayMatrix&>(scorers[0]->GetProbs());
 
-      mblas::ArrayMatrix Costs(Probs.rows(), 1);
-      for (size_t i = 0; i < prevHyps.size(); ++i) {
-        Costs.data()[i] = prevHyps[i]->GetCost();
-      }
-
-      Probs *= weights_.at(scorers[0]->GetName());
-      AddBiasVector<byColumn>(Probs, Costs);
-
-      for (size_t i = 1; i < scorers.size(); ++i) {
-        mblas::ArrayMatrix &currProb = static_cast<mblas::ArrayMatrix&>(scorers[i]->GetProbs());
+      // With fusing the single scorer left its output unnormalized, the
+      // log-softmax is folded into the selection below.
+      const bool fused = god_.UseFusedSoftmax();
+
+      // On the first step every sentence has a single hypothesis, afterwards
+      // sentence i owns beamSizes[i] consecutive rows of Probs.
+      const bool isFirst = !prevHyps[0]->GetPrevHyp();
+      // greedy decoders leave Probs empty, any size above the largest word
+      // id works for the keys
+      const size_t vocabSize = greedy_ ? scorers[0]->GetVocabSize() : Probs.columns();
+
+      size_t hypStart = 0;
+      for (size_t batchId = 0; batchId < beamSizes.size(); ++batchId) {
+        size_t beamSize = beamSizes[batchId];
+        size_t hypRows = isFirst ? 1 : beamSize;
+        if (beamSize == 0) {
+          continue;
+        }
 
-        Probs += weights_.at(scorers[i]->GetName()) * currProb;
-      }
+        if (greedy_) {
+          const CPUEncoderDecoderBase& encdec = static_cast<const CPUEncoderDecoderBase&>(*scorers[0]);
+          keys_.assign(1, hypStart * vocabSize + encdec.GetBestWords()[hypStart]);
+          costs_.assign(1, prevHyps[hypStart]->GetCost()
+                           + weights_.at(scorers[0]->GetName()) * encdec.GetBestScores()[hypStart]);
+        } else if (fused) {
+          FusedTopK(Probs, prevHyps, scorers[0], hypStart, hypRows, beamSize);
+        } else {
+          CombinedTopK(scorers, prevHyps, hypStart, hypRows, beamSize);
+        }
 
-      size_t size = Probs.rows() * Probs.columns(); // Probs.size();
-      std::vector<size_t> keys(size);
-      for (size_t i = 0; i < keys.size(); ++i) {
-        keys[i] = i;
-      }
+        for (size_t i = 0; i < beamSize; i++) {
+          size_t wordIndex = keys_[i] % vocabSize;
 
-      size_t beamSize = beamSizes[0];
+          if (isInputFiltered_) {
+            wordIndex = filterIndices[wordIndex];
+          }
 
-      std::vector<size_t> bestKeys(beamSize);
-      std::vector<float> bestCosts(beamSize);
+          size_t hypIndex  = keys_[i] / vocabSize;
+          float cost = costs_[i];
+
+          HypothesisPtr hyp;
+          if (returnAttentionWeights_) {
+            std::vector<SoftAlignmentPtr> alignments;
+            for (auto& scorer : scorers) {
+              if (CPU::CPUEncoderDecoderBase* encdec = dynamic_cast<CPU::CPUEncoderDecoderBase*>(scorer.get())) {
+                auto& attention = encdec->GetAttention();
+                size_t words = encdec->GetSentenceLengths()[batchId];
+                alignments.emplace_back(new SoftAlignment(attention.begin(hypIndex),
+                                                          attention.begin(hypIndex) + words));
+              } else {
+                amunmt_UTIL_THROW2("Return Alignment is allowed only with Nematus scorer.");
+              }
+            }
 
-      if (forbidUNK_) {
-        blaze::column(Probs, UNK_ID) = std::numeric_limits<float>::lowest();
-      }
+            hyp = arena.New(prevHyps[hypIndex], wordIndex, hypIndex, cost, std::move(alignments));
+          } else {
+            hyp = arena.New(prevHyps[hypIndex], wordIndex, hypIndex, cost);
+          }
 
-      std::nth_element(keys.begin(), keys.begin() + beamSize, keys.end(),
-                       ProbCompare(Probs.data()));
+          if (god_.ReturnNBestList()) {
+            hyp->GetCostBreakdown().resize(scorers.size());
+            float sum = 0;
+            for(size_t j = 0; j < scorers.size(); ++j) {
+              if (j == 0) {
+                hyp->GetCostBreakdown()[0] = cost;
+              } else {
+                mblas::ArrayMatrix &currProb = static_cast<mblas::ArrayMatrix&>(scorers[j]->GetProbs());
+                if (prevHyps[hypIndex]->GetCostBreakdown().size() < scorers.size())
+                  const_cast<HypothesisPtr&>(prevHyps[hypIndex])->GetCostBreakdown().resize(scorers.size(), 0.0);
+                float cost = currProb.data()[keys_[i]] + const_cast<HypothesisPtr&>(prevHyps[hypIndex])->GetCostBreakdown()[j];
+                sum += weights_.at(scorers[j]->GetName()) * cost;
+                hyp->GetCostBreakdown()[j] = cost;
+              }
+            }
+            hyp->GetCostBreakdown()[0] -= sum;
+            hyp->GetCostBreakdown()[0] /= weights_.at(scorers[0]->GetName());
+          }
+          beams[batchId].push_back(hyp);
+        }
 
-      for (size_t i = 0; i < beamSize; ++i) {
-        bestKeys[i] = keys[i];
-        bestCosts[i] = Probs.data()[keys[i]];
+        hypStart += hypRows;
       }
 
-      std::vector<std::vector<float>> breakDowns;
-      if (god_.ReturnNBestList()) {
-        breakDowns.push_back(bestCosts);
-        for (auto& scorer : scorers) {
-          std::vector<float> modelCosts(beamSize);
-          mblas::ArrayMatrix &currProb = static_cast<mblas::ArrayMatrix&>(scorer->GetProbs());
+      Prune(beams, beamSizes);
+    }
 
-          auto it = boost::make_permutation_iterator(currProb.begin(), keys.begin());
-          std::copy(it, it + beamSize, modelCosts.begin());
-          breakDowns.push_back(modelCosts);
+  private:
+    // Best beamSize entries over the rows of one sentence in a single pass
+    // per row: the log-normalizer of the row comes from one max/exp-sum
+    // sweep, the scores are then computed on the fly and fed into a min-heap
+    // of the current best, so no normalized row is ever written. Fills keys_
+    // and costs_ best first.
+    void FusedTopK(const mblas::ArrayMatrix& Probs, const Beam& prevHyps,
+                   const ScorerPtr& scorer, size_t hypStart, size_t hypRows, size_t beamSize)
+    {
+      const size_t vocabSize = Probs.columns();
+      const float weight = weights_.at(scorer->GetName());
+
+      heap_.clear();
+      for (size_t hypIndex = hypStart; hypIndex < hypStart + hypRows; ++hypIndex) {
+        const float* row = Probs.data() + hypIndex * vocabSize;
+
+        float logZ = 0.0f;
+        if (doSoftmax_) {
+          float max, sum;
+          mblas::RowMaxExpSum(row, vocabSize, max, sum);
+          logZ = max + mblas::logapprox(sum);
         }
-      }
-
-      for (size_t i = 0; i < beamSize; i++) {
-        size_t wordIndex = bestKeys[i] % Probs.columns();
+        const float shift = prevHyps[hypIndex]->GetCost() - weight * logZ;
 
-        if (isInputFiltered_) {
-          wordIndex = filterIndices[wordIndex];
+        for (size_t j = 0; j < vocabSize; ++j) {
+          if (forbidUNK_ && j == UNK_ID) {
+            continue;
+          }
+          Push(weight * row[j] + shift, hypIndex * vocabSize + j, beamSize);
         }
+      }
+      PopAll();
+    }
 
-        size_t hypIndex  = bestKeys[i] / Probs.columns();
-        float cost = bestCosts[i];
-
-        HypothesisPtr hyp;
-        if (returnAttentionWeights_) {
-          std::vector<SoftAlignmentPtr> alignments;
-          for (auto& scorer : scorers) {
-            if (CPU::CPUEncoderDecoderBase* encdec = dynamic_cast<CPU::CPUEncoderDecoderBase*>(scorer.get())) {
-              auto& attention = encdec->GetAttention();
-              alignments.emplace_back(new SoftAlignment(attention.begin(hypIndex),
-                                                        attention.end(hypIndex)));
-            } else {
-              amunmt_UTIL_THROW2("Return Alignment is allowed only with Nematus scorer.");
+    // The same for an ensemble of normalized scorers: the weighted sum of
+    // their rows plus the hypothesis cost is built in rowScores_ one row at
+    // a time, in the order the old whole-matrix sums used, and fed to the
+    // heap. The scorers' matrices are left as they are for the n-best
+    // breakdown.
+    void CombinedTopK(const std::vector<ScorerPtr>& scorers, const Beam& prevHyps,
+                      size_t hypStart, size_t hypRows, size_t beamSize)
+    {
+      const size_t vocabSize = scorers[0]->GetProbs().dim(1);
+      rowScores_.resize(vocabSize);
+      float* scores = rowScores_.data();
+
+      heap_.clear();
+      for (size_t hypIndex = hypStart; hypIndex < hypStart + hypRows; ++hypIndex) {
+        const float cost = prevHyps[hypIndex]->GetCost();
+        for (size_t s = 0; s < scorers.size(); ++s) {
+          const float* row = static_cast<mblas::ArrayMatrix&>(scorers[s]->GetProbs()).data()
+                           + hypIndex * vocabSize;
+          const float weight = weights_.at(scorers[s]->GetName());
+          if (s == 0) {
+            for (size_t j = 0; j < vocabSize; ++j) {
+              scores[j] = weight * row[j] + cost;
+            }
+          } else {
+            for (size_t j = 0; j < vocabSize; ++j) {
+              scores[j] += weight * row[j];
             }
           }
-
-          hyp.reset(new Hypothesis(prevHyps[hypIndex], wordIndex, hypIndex, cost, alignments));
-        } else {
-          hyp.reset(new Hypothesis(prevHyps[hypIndex], wordIndex, hypIndex, cost));
         }
 
-        if (god_.ReturnNBestList()) {
-          hyp->GetCostBreakdown().resize(scorers.size());
-          float sum = 0;
-          for(size_t j = 0; j < scorers.size(); ++j) {
-            if (j == 0) {
-              hyp->GetCostBreakdown()[0] = breakDowns[0][i];
-            } else {
-              float cost = 0;
-              if (j < scorers.size()) {
-                if (prevHyps[hypIndex]->GetCostBreakdown().size() < scorers.size())
-                  const_cast<HypothesisPtr&>(prevHyps[hypIndex])->GetCostBreakdown().resize(scorers.size(), 0.0);
-                cost = breakDowns[j][i] + const_cast<HypothesisPtr&>(prevHyps[hypIndex])->GetCostBreakdown()[j];
-              }
-              sum += weights_.at(scorers[j]->GetName()) * cost;
-              hyp->GetCostBreakdown()[j] = cost;
-            }
+        for (size_t j = 0; j < vocabSize; ++j) {
+          if (forbidUNK_ && j == UNK_ID) {
+            continue;
           }
-          hyp->GetCostBreakdown()[0] -= sum;
-          hyp->GetCostBreakdown()[0] /= weights_.at(scorers[0]->GetName());
+          Push(scores[j], hypIndex * vocabSize + j, beamSize);
         }
-        beams[0].push_back(hyp);
+      }
+      PopAll();
+    }
+
+    // keeps the beamSize best candidates in the min-heap heap_
+    void Push(float score, size_t key, size_t beamSize) {
+      typedef std::pair<float, size_t> Entry;
+      if (heap_.size() < beamSize) {
+        heap_.emplace_back(score, key);
+        std::push_heap(heap_.begin(), heap_.end(), std::greater<Entry>());
+      } else if (score > heap_.front().first) {
+        std::pop_heap(heap_.begin(), heap_.end(), std::greater<Entry>());
+        heap_.back() = Entry(score, key);
+        std::push_heap(heap_.begin(), heap_.end(), std::greater<Entry>());
       }
     }
+
+    // moves the heap into keys_ and costs_, best first
+    void PopAll() {
+      typedef std::pair<float, size_t> Entry;
+      std::sort_heap(heap_.begin(), heap_.end(), std::greater<Entry>());
+
+      keys_.resize(heap_.size());
+      costs_.resize(heap_.size());
+      for (size_t i = 0; i < heap_.size(); ++i) {
+        costs_[i] = heap_[i].first;
+        keys_[i] = heap_[i].second;
+      }
+    }
+
+    const bool doSoftmax_;
+    const bool greedy_;
+
+    std::vector<size_t> keys_;
+    std::vector<float> costs_;
+    std::vector<std::pair<float, size_t>> heap_;
+    std::vector<float> rowScores_;
 };
 
 }  // namespace CPU
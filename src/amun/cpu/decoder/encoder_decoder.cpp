@@ -3,6 +3,7 @@
 #include <vector>
 #include <yaml-cpp/yaml.h>
 
+#include "common/god.h"
 #include "common/scorer.h"
 
 namespace amunmt {
@@ -19,6 +20,10 @@ CPUEncoderDecoderBase::CPUEncoderDecoderBase(
   : Scorer(god, name, config, tab)
 {}
 
+bool CPUEncoderDecoderBase::UseGreedy(const God &god) {
+  return god.UseFusedSoftmax() && god.GetOptions().beamSize == 1 && !god.ReturnNBestList();
+}
+
 State* CPUEncoderDecoderBase::NewState() const {
   return new EDState();
 }
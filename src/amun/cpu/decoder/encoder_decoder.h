@@ -22,6 +22,14 @@ class CPUEncoderDecoderBase : public Scorer {
 
     virtual State* NewState() const;
 
+    // Greedy search with a single scorer: the decoder only finds the best
+    // word of every row, see GetBestWords, and GetProbs stays empty.
+    static bool UseGreedy(const God &god);
+
+    virtual const std::vector<unsigned>& GetBestWords() const = 0;
+    // unnormalized log-probabilities of the best words
+    virtual const std::vector<float>& GetBestScores() const = 0;
+
     virtual void GetAttention(mblas::Tensor& Attention) = 0;
     virtual mblas::Tensor& GetAttention() = 0;
 
@@ -37,8 +45,14 @@ class CPUEncoderDecoderBase : public Scorer {
       return nullptr;
     }
 
+    const std::vector<unsigned>& GetSentenceLengths() const {
+      return sentenceLengths_;
+    }
+
   protected:
+    // one block of max-length rows per sentence in the batch
     mblas::Tensor SourceContext_;
+    std::vector<unsigned> sentenceLengths_;
 };
 
 
@@ -1,10 +1,14 @@
 #include "cpu/decoder/encoder_decoder_loader.h"
 
+#include <exception>
+#include <thread>
 #include <vector>
 #include <yaml-cpp/yaml.h>
 
+#include "common/cpu_topology.h"
 #include "common/god.h"
 #include "cpu/decoder/best_hyps.h"
+#include "cpu/npz_converter.h"
 #include "cpu/dl4mt/encoder_decoder.h"
 #include "cpu/nematus/encoder_decoder.h"
 
@@ -19,28 +23,85 @@ EncoderDecoderLoader::EncoderDecoderLoader(
   : Loader(name, config)
 {}
 
-void EncoderDecoderLoader::Load(const God&) {
+void EncoderDecoderLoader::Load(const God& god) {
   std::string path = Get<std::string>("path");
   std::string type = Get<std::string>("type");
 
+  std::string quantize = Has("quantize") ? Get<std::string>("quantize") : "none";
+  amunmt_UTIL_THROW_IF2(quantize != "none" && quantize != "int8",
+                        "Unknown quantize value " << quantize << ", use none or int8");
+  amunmt_UTIL_THROW_IF2(quantize == "int8" && type != "nematus2",
+                        "int8 quantization is only supported for nematus2 models");
+
   LOG(info)->info("Loading model {}", path);
   LOG(info)->info("Model type: {}", type);
+  if (type == "nematus2" && quantize == "int8") {
+    LOG(info)->info("Quantizing decoder weights to int8");
+  }
+
+  const std::vector<std::vector<int>>& nodes = god.GetNumaNodeCPUs();
+  if (nodes.empty()) {
+    LoadReplica(0, false);
+    return;
+  }
+
+  // Every node gets its own copy, loaded by a thread running on that node
+  // so that its pages are allocated there. Binary models are copied out of
+  // the mapping, whose pages may be on any node.
+  for (unsigned node = 0; node < nodes.size(); ++node) {
+    if (nodes[node].empty()) {
+      continue;
+    }
+    LOG(info)->info("Loading a copy for NUMA node {}", node);
+    std::exception_ptr error;
+    std::thread loader([&] {
+      try {
+        PinCurrentThread(nodes[node]);
+        LoadReplica(node, true);
+      } catch (...) {
+        error = std::current_exception();
+      }
+    });
+    loader.join();
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+void EncoderDecoderLoader::LoadReplica(unsigned numaNode, bool copy) {
+  std::string path = Get<std::string>("path");
+  std::string type = Get<std::string>("type");
+  std::string quantize = Has("quantize") ? Get<std::string>("quantize") : "none";
+
+  NpzConverter model(path, copy);
   if (type == "nematus2") {
-    nematusModels_.emplace_back(new Nematus::Weights(path, 0));
+    if (nematusModels_.size() <= numaNode) {
+      nematusModels_.resize(numaNode + 1);
+    }
+    nematusModels_[numaNode].reset(new Nematus::Weights(model, 0, quantize == "int8"));
   } else {
-    dl4mtModels_.emplace_back(new dl4mt::Weights(path, 0));
+    if (dl4mtModels_.size() <= numaNode) {
+      dl4mtModels_.resize(numaNode + 1);
+    }
+    dl4mtModels_[numaNode].reset(new dl4mt::Weights(model, 0));
   }
 }
 
-ScorerPtr EncoderDecoderLoader::NewScorer(const God &god, const DeviceInfo&) const {
+ScorerPtr EncoderDecoderLoader::NewScorer(const God &god, const DeviceInfo &deviceInfo) const {
   size_t tab = Has("tab") ? Get<size_t>("tab") : 0;
   std::string type = Get<std::string>("type");
+  unsigned node = deviceInfo.numaNode;
   if (type == "nematus2") {
+    amunmt_UTIL_THROW_IF2(node >= nematusModels_.size() || !nematusModels_[node],
+                          "No copy of " << name_ << " for NUMA node " << node);
     return ScorerPtr(new Nematus::EncoderDecoder(god, name_, config_,
-                                              tab, *nematusModels_[0]));
+                                              tab, *nematusModels_[node]));
   }
+  amunmt_UTIL_THROW_IF2(node >= dl4mtModels_.size() || !dl4mtModels_[node],
+                        "No copy of " << name_ << " for NUMA node " << node);
   return ScorerPtr(new dl4mt::EncoderDecoder(god, name_, config_,
-                                             tab, *dl4mtModels_[0]));
+                                             tab, *dl4mtModels_[node]));
 }
 
 BaseBestHypsPtr EncoderDecoderLoader::GetBestHyps(const God &god, const DeviceInfo &deviceInfo) const {
@@ -31,6 +31,9 @@ class EncoderDecoderLoader : public Loader {
     BaseBestHypsPtr GetBestHyps(const God &god, const DeviceInfo &deviceInfo) const;
 
   private:
+    void LoadReplica(unsigned numaNode, bool copy);
+
+    // by NUMA node, only index 0 without cpu-affinity
     std::vector<std::unique_ptr<dl4mt::Weights>> dl4mtModels_;
     std::vector<std::unique_ptr<Nematus::Weights>> nematusModels_;
 };
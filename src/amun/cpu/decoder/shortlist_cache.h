@@ -0,0 +1,63 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <vector>
+
+namespace amunmt {
+namespace CPU {
+
+// The last few output layers restricted to a shortlist of target words,
+// most recently used first. Batches whose sentences bring in the same
+// shortlist reuse the filtered matrices instead of gathering them again.
+// Keeps nothing with capacity 0.
+template <class T>
+class ShortlistCache {
+  public:
+    void SetCapacity(size_t capacity) {
+      capacity_ = capacity;
+      entries_.clear();
+    }
+
+    // The cached value for ids, or build(ids) which is then cached
+    template <class F>
+    std::shared_ptr<const T> Get(const std::vector<unsigned>& ids, F build) {
+      size_t hash = Hash(ids);
+      for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if (it->hash == hash && it->ids == ids) {
+          entries_.splice(entries_.begin(), entries_, it);
+          return it->value;
+        }
+      }
+
+      std::shared_ptr<const T> value = build(ids);
+      if (capacity_ > 0) {
+        entries_.push_front(Entry{hash, ids, value});
+        if (entries_.size() > capacity_) {
+          entries_.pop_back();
+        }
+      }
+      return value;
+    }
+
+  private:
+    struct Entry {
+      size_t hash;
+      std::vector<unsigned> ids;
+      std::shared_ptr<const T> value;
+    };
+
+    static size_t Hash(const std::vector<unsigned>& ids) {
+      size_t hash = ids.size();
+      for (unsigned id : ids) {
+        hash ^= id + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+      }
+      return hash;
+    }
+
+    size_t capacity_ = 0;
+    std::list<Entry> entries_;
+};
+
+}
+}
@@ -4,6 +4,7 @@
 #include "model.h"
 #include "gru.h"
 #include "common/god.h"
+#include "cpu/decoder/shortlist_cache.h"
 
 namespace amunmt {
 namespace CPU {
@@ -48,15 +49,19 @@ class Decoder {
 
         void InitializeState(mblas::Tensor& State,
                              const mblas::Tensor& SourceContext,
-                             const size_t batchSize = 1) {
+                             const size_t batchSize,
+                             const std::vector<unsigned>& sentenceLengths) {
           using namespace mblas;
+          assert(batchSize == sentenceLengths.size());
 
-          // Calculate mean of source context, rowwise
-          // Repeat mean batchSize times by broadcasting
-          Temp1_ = Mean<byRow, Tensor>(SourceContext);
+          // Calculate mean of each sentence's source context, rowwise
+          size_t maxLength = SourceContext.rows() / batchSize;
           Temp2_.resize(batchSize, SourceContext.columns());
-          Temp2_ = 0.0f;
-          AddBiasVector<byRow>(Temp2_, Temp1_);
+          for (size_t i = 0; i < batchSize; ++i) {
+            Temp1_ = Mean<byRow, Tensor>(blaze::submatrix(SourceContext, i * maxLength, 0,
+                                                          sentenceLengths[i], SourceContext.columns()));
+            blaze::row(Temp2_, i) = blaze::row(Temp1_, 0);
+          }
 
           State = Temp2_ * w_.Wi_;
 
@@ -121,7 +126,9 @@ class Decoder {
 
         void GetAlignedSourceContext(mblas::Tensor& AlignedSourceContext,
                                      const mblas::Tensor& HiddenState,
-                                     const mblas::Tensor& SourceContext) {
+                                     const mblas::Tensor& SourceContext,
+                                     const std::vector<unsigned>& sentenceLengths,
+                                     const std::vector<unsigned>& beamSizes) {
           using namespace mblas;
 
           Temp2_ = HiddenState * w_.W_;
@@ -129,20 +136,36 @@ class Decoder {
             LayerNormalization(Temp2_, w_.Gamma_2_);
           }
 
-          Temp1_ = Broadcast<Tensor>(Tanh(), SCU_, Temp2_);
-
-          A_.resize(Temp1_.rows(), 1);
-          blaze::column(A_, 0) = Temp1_ * V_;
-          size_t words = SourceContext.rows();
-          // batch size, for batching, divide by numer of sentences
-          size_t batchSize = HiddenState.rows();
-          Reshape(A_, batchSize, words); // due to broadcasting above
-
-          float bias = w_.C_(0,0);
-          blaze::forEach(A_, [=](float x) { return x + bias; });
-
-          mblas::SafeSoftmax(A_);
-          AlignedSourceContext = A_ * SourceContext;
+          // attention is masked per sentence, layout as in the Nematus decoder
+          size_t batchSize = sentenceLengths.size();
+          size_t maxLength = SourceContext.rows() / batchSize;
+          size_t cols = SourceContext.columns();
+
+          A_.resize(HiddenState.rows(), maxLength);
+          A_ = 0.0f;
+          AlignedSourceContext.resize(HiddenState.rows(), cols);
+
+          size_t hypStart = 0;
+          for (size_t i = 0; i < batchSize; ++i) {
+            size_t hyps = beamSizes[i];
+            size_t words = sentenceLengths[i];
+            if (hyps == 0) {
+              continue;
+            }
+
+            auto A = blaze::submatrix(A_, hypStart, 0, hyps, words);
+            AdditiveAttention(A,
+                              blaze::submatrix(SCU_, i * maxLength, 0, words, SCU_.columns()),
+                              blaze::submatrix(Temp2_, hypStart, 0, hyps, Temp2_.columns()),
+                              V_);
+
+            mblas::SafeSoftmax(A);
+            blaze::submatrix(AlignedSourceContext, hypStart, 0, hyps, cols)
+              = A * blaze::submatrix(SourceContext, i * maxLength, 0, words, cols);
+
+            hypStart += hyps;
+          }
+          assert(hypStart == HiddenState.rows());
         }
 
         void GetAttention(mblas::Tensor& Attention) {
@@ -157,7 +180,6 @@ class Decoder {
         const Weights& w_;
 
         mblas::Tensor SCU_;
-        mblas::Tensor Temp1_;
         mblas::Tensor Temp2_;
         mblas::Tensor A_;
         mblas::ColumnVector V_;
@@ -169,13 +191,25 @@ class Decoder {
       public:
         Softmax(const Weights& model)
         : w_(model),
-        filtered_(false)
+        greedy_(false),
+        skip_(-1)
         {}
 
+        void SetGreedy(bool forbidUNK) {
+          greedy_ = true;
+          skip_ = forbidUNK ? UNK_ID : -1;
+        }
+
+        // Keep the filtered output layers of the last capacity shortlists
+        void SetShortlistCache(size_t capacity) {
+          shortlists_.SetCapacity(capacity);
+        }
+
         void GetProbs(mblas::ArrayMatrix& Probs,
                   const mblas::Tensor& State,
                   const mblas::Tensor& Embedding,
-                  const mblas::Tensor& AlignedSourceContext) {
+                  const mblas::Tensor& AlignedSourceContext,
+                  bool useFusedSoftmax) {
           using namespace mblas;
 
 
@@ -199,29 +233,62 @@ class Decoder {
 
           auto t = blaze::forEach(T1_ + T2_ + T3_, Tanh());
 
+          if (greedy_) {
+            T1_ = t;
+            if (!filtered_) {
+              ProdArgMax(BestWords_, BestScores_, T1_, w_.W4_, w_.B4_, skip_);
+            } else {
+              ProdArgMax(BestWords_, BestScores_, T1_, filtered_->W4, filtered_->B4, skip_);
+            }
+            return;
+          }
+
           if(!filtered_) {
             Probs = t * w_.W4_;
             AddBiasVector<byRow>(Probs, w_.B4_);
           } else {
-            Probs = t * FilteredW4_;
-            AddBiasVector<byRow>(Probs, FilteredB4_);
+            Probs = t * filtered_->W4;
+            AddBiasVector<byRow>(Probs, filtered_->B4);
+          }
+          if (!useFusedSoftmax) {
+            LogSoftmax(Probs);
           }
-          LogSoftmax(Probs);
         }
 
         void Filter(const std::vector<unsigned>& ids) {
-          filtered_ = true;
-          using namespace mblas;
-          FilteredW4_ = Assemble<byColumn, Tensor>(w_.W4_, ids);
-          FilteredB4_ = Assemble<byColumn, Tensor>(w_.B4_, ids);
+          filtered_ = shortlists_.Get(ids, [this](const std::vector<unsigned>& ids) {
+            using namespace mblas;
+            std::shared_ptr<FilteredOutput> out(new FilteredOutput());
+            out->W4 = Assemble<byColumn, Tensor>(w_.W4_, ids);
+            out->B4 = Assemble<byColumn, Tensor>(w_.B4_, ids);
+            return out;
+          });
+        }
+
+        const std::vector<unsigned>& GetBestWords() const {
+          return BestWords_;
+        }
+
+        const std::vector<float>& GetBestScores() const {
+          return BestScores_;
         }
 
       private:
         const Weights& w_;
-        bool filtered_;
+        bool greedy_;
+        size_t skip_;
 
-        mblas::Tensor FilteredW4_;
-        mblas::Tensor FilteredB4_;
+        std::vector<unsigned> BestWords_;
+        std::vector<float> BestScores_;
+
+        // output layer restricted to the columns of a shortlist
+        struct FilteredOutput {
+          mblas::Tensor W4;
+          mblas::Tensor B4;
+        };
+
+        std::shared_ptr<const FilteredOutput> filtered_;
+        ShortlistCache<FilteredOutput> shortlists_;
 
         mblas::Tensor T1_;
         mblas::Tensor T2_;
@@ -240,21 +307,42 @@ class Decoder {
     void Decode(mblas::Tensor& NextState,
                   const mblas::Tensor& State,
                   const mblas::Tensor& Embeddings,
-                  const mblas::Tensor& SourceContext) {
+                  const mblas::Tensor& SourceContext,
+                  const std::vector<unsigned>& sentenceLengths,
+                  const std::vector<unsigned>& beamSizes,
+                  bool useFusedSoftmax) {
       GetHiddenState(HiddenState_, State, Embeddings);
-      GetAlignedSourceContext(AlignedSourceContext_, HiddenState_, SourceContext);
+      GetAlignedSourceContext(AlignedSourceContext_, HiddenState_, SourceContext,
+                              sentenceLengths, beamSizes);
       GetNextState(NextState, HiddenState_, AlignedSourceContext_);
-      GetProbs(NextState, Embeddings, AlignedSourceContext_);
+      GetProbs(NextState, Embeddings, AlignedSourceContext_, useFusedSoftmax);
     }
 
     mblas::ArrayMatrix& GetProbs() {
       return Probs_;
     }
 
+    void SetGreedy(bool forbidUNK) {
+      softmax_.SetGreedy(forbidUNK);
+    }
+
+    void SetShortlistCache(size_t capacity) {
+      softmax_.SetShortlistCache(capacity);
+    }
+
+    const std::vector<unsigned>& GetBestWords() const {
+      return softmax_.GetBestWords();
+    }
+
+    const std::vector<float>& GetBestScores() const {
+      return softmax_.GetBestScores();
+    }
+
     void EmptyState(mblas::Tensor& State,
                     const mblas::Tensor& SourceContext,
-                    size_t batchSize = 1) {
-    	rnn1_.InitializeState(State, SourceContext, batchSize);
+                    size_t batchSize,
+                    const std::vector<unsigned>& sentenceLengths) {
+    	rnn1_.InitializeState(State, SourceContext, batchSize, sentenceLengths);
     	attention_.Init(SourceContext);
     }
 
@@ -295,8 +383,11 @@ class Decoder {
 
     void GetAlignedSourceContext(mblas::Tensor& AlignedSourceContext,
                                  const mblas::Tensor& HiddenState,
-                                 const mblas::Tensor& SourceContext) {
-    	attention_.GetAlignedSourceContext(AlignedSourceContext, HiddenState, SourceContext);
+                                 const mblas::Tensor& SourceContext,
+                                 const std::vector<unsigned>& sentenceLengths,
+                                 const std::vector<unsigned>& beamSizes) {
+    	attention_.GetAlignedSourceContext(AlignedSourceContext, HiddenState, SourceContext,
+    	                                   sentenceLengths, beamSizes);
     }
 
     void GetNextState(mblas::Tensor& State,
@@ -308,8 +399,9 @@ class Decoder {
 
     void GetProbs(const mblas::Tensor& State,
                   const mblas::Tensor& Embedding,
-                  const mblas::Tensor& AlignedSourceContext) {
-      softmax_.GetProbs(Probs_, State, Embedding, AlignedSourceContext);
+                  const mblas::Tensor& AlignedSourceContext,
+                  bool useFusedSoftmax) {
+      softmax_.GetProbs(Probs_, State, Embedding, AlignedSourceContext, useFusedSoftmax);
     }
 
   private:
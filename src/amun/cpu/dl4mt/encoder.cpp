@@ -1,4 +1,5 @@
 #include "encoder.h"
+#include "common/sentences.h"
 
 using namespace std;
 
@@ -28,6 +29,27 @@ void Encoder::Encode(const std::vector<unsigned>& words,
 						  context, true);
 }
 
+// same padded layout as Nematus::Encoder::GetContext
+void Encoder::Encode(const Sentences& sources, unsigned tab,
+                     mblas::Tensor& context,
+                     std::vector<unsigned>& sentenceLengths) {
+  size_t maxLength = 0;
+  sentenceLengths.resize(sources.size());
+  for (size_t i = 0; i < sources.size(); ++i) {
+    sentenceLengths[i] = sources.Get(i).GetWords(tab).size();
+    maxLength = std::max<size_t>(maxLength, sentenceLengths[i]);
+  }
+
+  size_t cols = forwardRnn_.GetStateLength() + backwardRnn_.GetStateLength();
+  context.resize(sources.size() * maxLength, cols);
+  context = 0.0f;
+
+  for (size_t i = 0; i < sources.size(); ++i) {
+    Encode(sources.Get(i).GetWords(tab), SentenceContext_);
+    blaze::submatrix(context, i * maxLength, 0, sentenceLengths[i], cols) = SentenceContext_;
+  }
+}
+
 }
 }
 }
@@ -5,6 +5,9 @@
 #include "../dl4mt/gru.h"
 
 namespace amunmt {
+
+class Sentences;
+
 namespace CPU {
 namespace dl4mt {
 
@@ -89,11 +92,19 @@ class Encoder {
     
     void Encode(const std::vector<unsigned>& words,
                     mblas::Tensor& context);
+
+    void Encode(const Sentences& sources,
+                unsigned tab,
+                mblas::Tensor& context,
+                std::vector<unsigned>& sentenceLengths);
     
   private:
     Embeddings<Weights::Embeddings> embeddings_;
     RNN<Weights::GRU> forwardRnn_;
     RNN<Weights::GRU> backwardRnn_;
+
+    // reused to avoid allocation
+    mblas::Tensor SentenceContext_;
 };
 
 }
@@ -19,21 +19,21 @@ struct Weights {
     Embeddings(const NpzConverter& model, const std::string &key);
     Embeddings(const NpzConverter& model, const std::vector<std::pair<std::string, bool>> keys);
 
-    const mblas::Tensor E_;
+    const mblas::MappedTensor E_;
   };
 
   struct GRU {
 	GRU(const NpzConverter& model, const std::vector<std::string> &keys);
 
-    const mblas::Tensor W_;
-    const mblas::Tensor B_;
-    const mblas::Tensor U_;
-    const mblas::Tensor Wx_;
-    const mblas::Tensor Bx1_;
-    const mblas::Tensor Bx2_;
-    const mblas::Tensor Ux_;
-    const mblas::Tensor Gamma_1_;
-    const mblas::Tensor Gamma_2_;
+    const mblas::MappedTensor W_;
+    const mblas::MappedTensor B_;
+    const mblas::MappedTensor U_;
+    const mblas::MappedTensor Wx_;
+    const mblas::MappedTensor Bx1_;
+    const mblas::MappedTensor Bx2_;
+    const mblas::MappedTensor Ux_;
+    const mblas::MappedTensor Gamma_1_;
+    const mblas::MappedTensor Gamma_2_;
   };
 
   //////////////////////////////////////////////////////////////////////////////
@@ -41,51 +41,51 @@ struct Weights {
   struct DecInit {
     DecInit(const NpzConverter& model);
 
-    const mblas::Tensor Wi_;
-    const mblas::Tensor Bi_;
-    const mblas::Tensor Gamma_;
+    const mblas::MappedTensor Wi_;
+    const mblas::MappedTensor Bi_;
+    const mblas::MappedTensor Gamma_;
   };
 
   struct DecGRU2 {
     DecGRU2(const NpzConverter& model);
 
-    const mblas::Tensor W_;
-    const mblas::Tensor B_;
-    const mblas::Tensor U_;
-    const mblas::Tensor Wx_;
-    const mblas::Tensor Bx2_;
-    const mblas::Tensor Bx1_;
-    const mblas::Tensor Ux_;
-    const mblas::Tensor Gamma_1_;
-    const mblas::Tensor Gamma_2_;
+    const mblas::MappedTensor W_;
+    const mblas::MappedTensor B_;
+    const mblas::MappedTensor U_;
+    const mblas::MappedTensor Wx_;
+    const mblas::MappedTensor Bx2_;
+    const mblas::MappedTensor Bx1_;
+    const mblas::MappedTensor Ux_;
+    const mblas::MappedTensor Gamma_1_;
+    const mblas::MappedTensor Gamma_2_;
   };
 
   struct DecAttention {
     DecAttention(const NpzConverter& model);
 
-    const mblas::Tensor V_;
-    const mblas::Tensor W_;
-    const mblas::Tensor B_;
-    const mblas::Tensor U_;
-    const mblas::Tensor C_;
-    const mblas::Tensor Gamma_1_;
-    const mblas::Tensor Gamma_2_;
+    const mblas::MappedTensor V_;
+    const mblas::MappedTensor W_;
+    const mblas::MappedTensor B_;
+    const mblas::MappedTensor U_;
+    const mblas::MappedTensor C_;
+    const mblas::MappedTensor Gamma_1_;
+    const mblas::MappedTensor Gamma_2_;
   };
 
   struct DecSoftmax {
     DecSoftmax(const NpzConverter& model);
 
-    const mblas::Tensor W1_;
-    const mblas::Tensor B1_;
-    const mblas::Tensor W2_;
-    const mblas::Tensor B2_;
-    const mblas::Tensor W3_;
-    const mblas::Tensor B3_;
-    const mblas::Tensor W4_;
-    const mblas::Tensor B4_;
-    const mblas::Tensor Gamma_0_;
-    const mblas::Tensor Gamma_1_;
-    const mblas::Tensor Gamma_2_;
+    const mblas::MappedTensor W1_;
+    const mblas::MappedTensor B1_;
+    const mblas::MappedTensor W2_;
+    const mblas::MappedTensor B2_;
+    const mblas::MappedTensor W3_;
+    const mblas::MappedTensor B3_;
+    const mblas::MappedTensor W4_;
+    const mblas::MappedTensor B4_;
+    const mblas::MappedTensor Gamma_0_;
+    const mblas::MappedTensor Gamma_1_;
+    const mblas::MappedTensor Gamma_2_;
   };
 
   //////////////////////////////////////////////////////////////////////////////
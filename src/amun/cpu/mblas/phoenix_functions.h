@@ -1,5 +1,7 @@
 #pragma once
 
+#include <immintrin.h>
+
 namespace amunmt {
 namespace CPU {
 namespace mblas
@@ -67,6 +69,46 @@ namespace mblas
       + (addcst + 0.69314718055995f*exp);
   }
   
+#if defined(__AVX2__) && defined(__FMA__)
+  /* expapprox on 8 floats at a time, same error bounds */
+  inline __m256 expapprox8(__m256 val) {
+    __m256 val2 = _mm256_fmadd_ps(_mm256_set1_ps(12102203.1615614f), val,
+                                  _mm256_set1_ps(1065353216.f));
+    __m256 val3 = _mm256_min_ps(val2, _mm256_set1_ps(exp_cst1));
+    __m256 val4 = _mm256_max_ps(val3, _mm256_set1_ps(exp_cst2));
+    __m256i val4i = _mm256_cvttps_epi32(val4);
+    __m256 xu = _mm256_castsi256_ps(_mm256_and_si256(val4i, _mm256_set1_epi32(0x7F800000)));
+    __m256 b = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(val4i, _mm256_set1_epi32(0x7FFFFF)),
+                                                   _mm256_set1_epi32(0x3F800000)));
+    __m256 p = _mm256_fmadd_ps(b, _mm256_set1_ps(1.3671023382430374383648148e-2f),
+                               _mm256_set1_ps(-2.88093587581985443087955e-3f));
+    p = _mm256_fmadd_ps(b, p, _mm256_set1_ps(0.168143436463395944830000f));
+    p = _mm256_fmadd_ps(b, p, _mm256_set1_ps(0.310670891004095530771135f));
+    p = _mm256_fmadd_ps(b, p, _mm256_set1_ps(0.510397365625862338668154f));
+    return _mm256_mul_ps(xu, p);
+  }
+#endif
+
+#ifdef __AVX512F__
+  /* expapprox on 16 floats at a time, same error bounds */
+  inline __m512 expapprox16(__m512 val) {
+    __m512 val2 = _mm512_fmadd_ps(_mm512_set1_ps(12102203.1615614f), val,
+                                  _mm512_set1_ps(1065353216.f));
+    __m512 val3 = _mm512_min_ps(val2, _mm512_set1_ps(exp_cst1));
+    __m512 val4 = _mm512_max_ps(val3, _mm512_set1_ps(exp_cst2));
+    __m512i val4i = _mm512_cvttps_epi32(val4);
+    __m512 xu = _mm512_castsi512_ps(_mm512_and_si512(val4i, _mm512_set1_epi32(0x7F800000)));
+    __m512 b = _mm512_castsi512_ps(_mm512_or_si512(_mm512_and_si512(val4i, _mm512_set1_epi32(0x7FFFFF)),
+                                                   _mm512_set1_epi32(0x3F800000)));
+    __m512 p = _mm512_fmadd_ps(b, _mm512_set1_ps(1.3671023382430374383648148e-2f),
+                               _mm512_set1_ps(-2.88093587581985443087955e-3f));
+    p = _mm512_fmadd_ps(b, p, _mm512_set1_ps(0.168143436463395944830000f));
+    p = _mm512_fmadd_ps(b, p, _mm512_set1_ps(0.310670891004095530771135f));
+    p = _mm512_fmadd_ps(b, p, _mm512_set1_ps(0.510397365625862338668154f));
+    return _mm512_mul_ps(xu, p);
+  }
+#endif
+
   inline float logitapprox(float x) {
     return 1.0f / (1.0f + expapprox(-x));
   }
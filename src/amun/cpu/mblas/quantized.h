@@ -0,0 +1,202 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <immintrin.h>
+
+namespace amunmt {
+namespace CPU {
+namespace mblas {
+
+////////////////////////////////////////////////////////////////////////
+// int8 copy of a weight matrix W for products x * W. Every column of W is
+// stored contiguously with its own scale, the rows of x are quantized with
+// one scale each when multiplied. Uses AVX-512 VNNI or AVX2 when the build
+// targets them.
+class QuantizedMatrix {
+  public:
+    QuantizedMatrix()
+      : rows_(0), cols_(0), stride_(0)
+    {}
+
+    template <class MT>
+    explicit QuantizedMatrix(const MT& W)
+      : rows_(W.rows()), cols_(W.columns()), stride_(Stride(W.rows())),
+        data_(cols_ * stride_, 0), scales_(cols_), sums_(cols_)
+    {
+      for (size_t j = 0; j < cols_; ++j) {
+        float maxAbs = 0.0f;
+        for (size_t i = 0; i < rows_; ++i) {
+          maxAbs = std::max(maxAbs, std::abs(W(i, j)));
+        }
+        scales_[j] = maxAbs > 0.0f ? maxAbs / 127.0f : 1.0f;
+
+        int8_t* col = &data_[j * stride_];
+        int32_t sum = 0;
+        for (size_t i = 0; i < rows_; ++i) {
+          col[i] = Round(W(i, j) / scales_[j]);
+          sum += col[i];
+        }
+        sums_[j] = sum;
+      }
+    }
+
+    size_t rows() const {
+      return rows_;
+    }
+
+    size_t columns() const {
+      return cols_;
+    }
+
+    bool empty() const {
+      return cols_ == 0;
+    }
+
+    // Matrix made of the given columns, as with Assemble<byColumn>
+    QuantizedMatrix Columns(const std::vector<unsigned>& ids) const {
+      QuantizedMatrix out;
+      out.rows_ = rows_;
+      out.cols_ = ids.size();
+      out.stride_ = stride_;
+      out.data_.resize(out.cols_ * stride_);
+      out.scales_.resize(out.cols_);
+      out.sums_.resize(out.cols_);
+      for (size_t j = 0; j < ids.size(); ++j) {
+        std::copy_n(&data_[ids[j] * stride_], stride_, &out.data_[j * stride_]);
+        out.scales_[j] = scales_[ids[j]];
+        out.sums_[j] = sums_[ids[j]];
+      }
+      return out;
+    }
+
+    // out = x * W, out has to be sized already
+    template <class MT1, class MT2>
+    void Multiply(MT1& out, const MT2& x) const {
+      assert(x.columns() == rows_);
+      assert(out.rows() == x.rows() && out.columns() == cols_);
+      size_t rows = x.rows();
+
+      static thread_local std::vector<int8_t> xData;
+      static thread_local std::vector<float> xScales;
+      QuantizeRows(x, xData, xScales);
+
+      for (size_t j = 0; j < cols_; ++j) {
+        const int8_t* col = &data_[j * stride_];
+        for (size_t i = 0; i < rows; ++i) {
+          int32_t dot = Dot(&xData[i * stride_], col, sums_[j]);
+          out(i, j) = dot * xScales[i] * scales_[j];
+        }
+      }
+    }
+
+    // For every row i of x the column j with the largest x * W + bias(0, j)
+    // in ids[i] and that value in scores[i], never choosing column skip.
+    // Nothing of the size of the product is stored.
+    template <class MT2, class MT3>
+    void ArgMax(std::vector<unsigned>& ids, std::vector<float>& scores,
+                const MT2& x, const MT3& bias, size_t skip) const {
+      assert(x.columns() == rows_);
+      size_t rows = x.rows();
+
+      static thread_local std::vector<int8_t> xData;
+      static thread_local std::vector<float> xScales;
+      QuantizeRows(x, xData, xScales);
+
+      ids.assign(rows, 0);
+      scores.assign(rows, std::numeric_limits<float>::lowest());
+      for (size_t j = 0; j < cols_; ++j) {
+        if (j == skip) {
+          continue;
+        }
+        const int8_t* col = &data_[j * stride_];
+        for (size_t i = 0; i < rows; ++i) {
+          float val = Dot(&xData[i * stride_], col, sums_[j]) * xScales[i] * scales_[j]
+                    + bias(0, j);
+          if (val > scores[i]) {
+            scores[i] = val;
+            ids[i] = j;
+          }
+        }
+      }
+    }
+
+  private:
+    // int8 copy of the rows of x, each row stride_ long, and their scales
+    template <class MT2>
+    void QuantizeRows(const MT2& x, std::vector<int8_t>& xData, std::vector<float>& xScales) const {
+      size_t rows = x.rows();
+      xData.assign(rows * stride_, 0);
+      xScales.resize(rows);
+
+      for (size_t i = 0; i < rows; ++i) {
+        float maxAbs = 0.0f;
+        for (size_t k = 0; k < rows_; ++k) {
+          maxAbs = std::max(maxAbs, std::abs(x(i, k)));
+        }
+        xScales[i] = maxAbs > 0.0f ? maxAbs / 127.0f : 1.0f;
+        float inv = 1.0f / xScales[i];
+
+        int8_t* row = &xData[i * stride_];
+        for (size_t k = 0; k < rows_; ++k) {
+          row[k] = Round(x(i, k) * inv);
+        }
+      }
+    }
+
+    // rows are padded with zeros to whole SIMD registers
+    static size_t Stride(size_t rows) {
+      return (rows + 63) / 64 * 64;
+    }
+
+    static int8_t Round(float val) {
+      return (int8_t)std::max(-127.0f, std::min(127.0f, std::round(val)));
+    }
+
+    int32_t Dot(const int8_t* x, const int8_t* w, int32_t sumW) const {
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+      // dpbusd multiplies unsigned by signed bytes: x + 128 is unsigned,
+      // the extra 128 * sum(w) is subtracted afterwards
+      const __m512i offset = _mm512_set1_epi8((char)0x80);
+      __m512i acc = _mm512_setzero_si512();
+      for (size_t k = 0; k < stride_; k += 64) {
+        __m512i xv = _mm512_xor_si512(_mm512_loadu_si512(x + k), offset);
+        __m512i wv = _mm512_loadu_si512(w + k);
+        acc = _mm512_dpbusd_epi32(acc, xv, wv);
+      }
+      return _mm512_reduce_add_epi32(acc) - 128 * sumW;
+#elif defined(__AVX2__)
+      __m256i acc = _mm256_setzero_si256();
+      for (size_t k = 0; k < stride_; k += 16) {
+        __m256i xv = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(x + k)));
+        __m256i wv = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(w + k)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(xv, wv));
+      }
+      __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+      sum = _mm_hadd_epi32(sum, sum);
+      sum = _mm_hadd_epi32(sum, sum);
+      return _mm_cvtsi128_si32(sum);
+#else
+      int32_t dot = 0;
+      for (size_t k = 0; k < stride_; ++k) {
+        dot += x[k] * w[k];
+      }
+      return dot;
+#endif
+    }
+
+    size_t rows_;
+    size_t cols_;
+    size_t stride_;
+    std::vector<int8_t> data_;
+    std::vector<float> scales_;
+    std::vector<int32_t> sums_;
+};
+
+}
+}
+}
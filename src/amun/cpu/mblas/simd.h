@@ -0,0 +1,266 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <immintrin.h>
+
+#include "phoenix_functions.h"
+
+namespace amunmt {
+namespace CPU {
+namespace mblas {
+
+////////////////////////////////////////////////////////////////////////
+// Widest float vector the build targets. The row kernels below are
+// written once against it and finish every row with scalar code.
+#if defined(__AVX512F__)
+struct SimdFloat {
+  typedef __m512 type;
+  static const unsigned width = 16;
+
+  static type set1(float v) { return _mm512_set1_ps(v); }
+  static type load(const float* p) { return _mm512_loadu_ps(p); }
+  static void store(float* p, type v) { _mm512_storeu_ps(p, v); }
+  static type add(type a, type b) { return _mm512_add_ps(a, b); }
+  static type sub(type a, type b) { return _mm512_sub_ps(a, b); }
+  static type mul(type a, type b) { return _mm512_mul_ps(a, b); }
+  static type fmadd(type a, type b, type c) { return _mm512_fmadd_ps(a, b, c); }
+  static type max(type a, type b) { return _mm512_max_ps(a, b); }
+  static type min(type a, type b) { return _mm512_min_ps(a, b); }
+  static type div(type a, type b) { return _mm512_div_ps(a, b); }
+  static type exp(type a) { return expapprox16(a); }
+  static float sum(type a) { return _mm512_reduce_add_ps(a); }
+  static float max(type a) { return _mm512_reduce_max_ps(a); }
+};
+#elif defined(__AVX2__) && defined(__FMA__)
+struct SimdFloat {
+  typedef __m256 type;
+  static const unsigned width = 8;
+
+  static type set1(float v) { return _mm256_set1_ps(v); }
+  static type load(const float* p) { return _mm256_loadu_ps(p); }
+  static void store(float* p, type v) { _mm256_storeu_ps(p, v); }
+  static type add(type a, type b) { return _mm256_add_ps(a, b); }
+  static type sub(type a, type b) { return _mm256_sub_ps(a, b); }
+  static type mul(type a, type b) { return _mm256_mul_ps(a, b); }
+  static type fmadd(type a, type b, type c) { return _mm256_fmadd_ps(a, b, c); }
+  static type max(type a, type b) { return _mm256_max_ps(a, b); }
+  static type min(type a, type b) { return _mm256_min_ps(a, b); }
+  static type div(type a, type b) { return _mm256_div_ps(a, b); }
+  static type exp(type a) { return expapprox8(a); }
+  static float sum(type a) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+  }
+  static float max(type a) {
+    __m128 m = _mm_max_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_max_ss(m, _mm_movehdup_ps(m));
+    return _mm_cvtss_f32(m);
+  }
+};
+#else
+struct SimdFloat {
+  typedef float type;
+  static const unsigned width = 1;
+
+  static type set1(float v) { return v; }
+  static type load(const float* p) { return *p; }
+  static void store(float* p, type v) { *p = v; }
+  static type add(type a, type b) { return a + b; }
+  static type sub(type a, type b) { return a - b; }
+  static type mul(type a, type b) { return a * b; }
+  static type fmadd(type a, type b, type c) { return a * b + c; }
+  static type max(type a, type b) { return std::max(a, b); }
+  static type min(type a, type b) { return std::min(a, b); }
+  static type div(type a, type b) { return a / b; }
+  static type exp(type a) { return expapprox(a); }
+  static float sum(type a) { return a; }
+  static float max(type a) { return a; }
+};
+#endif
+
+// tanhapprox on a whole register
+inline SimdFloat::type SimdTanh(SimdFloat::type x) {
+  typedef SimdFloat S;
+  x = S::max(S::min(x, S::set1(4.97f)), S::set1(-4.97f));
+  S::type x2 = S::mul(x, x);
+  S::type a = S::fmadd(x2, S::add(x2, S::set1(378.0f)), S::set1(17325.0f));
+  a = S::mul(x, S::fmadd(x2, a, S::set1(135135.0f)));
+  S::type b = S::fmadd(x2, S::set1(28.0f), S::set1(3150.0f));
+  b = S::fmadd(x2, S::fmadd(x2, b, S::set1(62370.0f)), S::set1(135135.0f));
+  return S::div(a, b);
+}
+
+////////////////////////////////////////////////////////////////////////
+// Kernels on one contiguous row of n floats
+
+inline float RowMax(const float* x, unsigned n) {
+  typedef SimdFloat S;
+  float max = std::numeric_limits<float>::lowest();
+  unsigned i = 0;
+  if (n >= S::width) {
+    // independent accumulators hide the latency of max
+    S::type m0 = S::set1(max), m1 = m0, m2 = m0, m3 = m0;
+    for (; i + 4 * S::width <= n; i += 4 * S::width) {
+      m0 = S::max(m0, S::load(x + i));
+      m1 = S::max(m1, S::load(x + i + S::width));
+      m2 = S::max(m2, S::load(x + i + 2 * S::width));
+      m3 = S::max(m3, S::load(x + i + 3 * S::width));
+    }
+    for (; i + S::width <= n; i += S::width) {
+      m0 = S::max(m0, S::load(x + i));
+    }
+    max = S::max(S::max(S::max(m0, m1), S::max(m2, m3)));
+  }
+  for (; i < n; ++i) {
+    max = std::max(max, x[i]);
+  }
+  return max;
+}
+
+// Sum of exp(x - shift), also stored to out unless it is null
+inline float RowExpSum(const float* x, unsigned n, float shift, float* out = nullptr) {
+  typedef SimdFloat S;
+  unsigned i = 0;
+  S::type vshift = S::set1(shift);
+  S::type s0 = S::set1(0.0f), s1 = s0;
+  for (; i + 2 * S::width <= n; i += 2 * S::width) {
+    S::type v0 = S::exp(S::sub(S::load(x + i), vshift));
+    S::type v1 = S::exp(S::sub(S::load(x + i + S::width), vshift));
+    if (out) {
+      S::store(out + i, v0);
+      S::store(out + i + S::width, v1);
+    }
+    s0 = S::add(s0, v0);
+    s1 = S::add(s1, v1);
+  }
+  for (; i + S::width <= n; i += S::width) {
+    S::type v = S::exp(S::sub(S::load(x + i), vshift));
+    if (out) {
+      S::store(out + i, v);
+    }
+    s0 = S::add(s0, v);
+  }
+  float sum = S::sum(S::add(s0, s1));
+  for (; i < n; ++i) {
+    float v = expapprox(x[i] - shift);
+    if (out) {
+      out[i] = v;
+    }
+    sum += v;
+  }
+  return sum;
+}
+
+// Maximum and sum(exp(x - max)) of a row. The row is walked in blocks
+// small enough to still be in L1 for the exp sweep after the max sweep,
+// so memory is read once; the running sum is rescaled once per block.
+inline void RowMaxExpSum(const float* x, unsigned n, float& max, float& sum) {
+  const unsigned block = 2048;
+  max = std::numeric_limits<float>::lowest();
+  sum = 0.0f;
+  for (unsigned start = 0; start < n; start += block) {
+    unsigned len = std::min(block, n - start);
+    float blockMax = RowMax(x + start, len);
+    float blockSum = RowExpSum(x + start, len, blockMax);
+    if (blockMax > max) {
+      sum = sum * expapprox(max - blockMax) + blockSum;
+      max = blockMax;
+    } else {
+      sum += blockSum * expapprox(blockMax - max);
+    }
+  }
+}
+
+// x = x * mul + add
+inline void RowAffine(float* x, unsigned n, float mul, float add) {
+  typedef SimdFloat S;
+  unsigned i = 0;
+  S::type vmul = S::set1(mul);
+  S::type vadd = S::set1(add);
+  for (; i + S::width <= n; i += S::width) {
+    S::store(x + i, S::fmadd(S::load(x + i), vmul, vadd));
+  }
+  for (; i < n; ++i) {
+    x[i] = x[i] * mul + add;
+  }
+}
+
+// Mean and variance in one read. Sums are taken relative to x[0], which
+// avoids the cancellation of the plain sum of squares.
+inline void RowMeanVariance(const float* x, unsigned n, float& mean, float& variance) {
+  typedef SimdFloat S;
+  float shift = x[0];
+  float sum = 0.0f;
+  float sumSq = 0.0f;
+  unsigned i = 0;
+  if (n >= S::width) {
+    S::type vshift = S::set1(shift);
+    S::type vsum = S::set1(0.0f);
+    S::type vsumSq = S::set1(0.0f);
+    for (; i + S::width <= n; i += S::width) {
+      S::type d = S::sub(S::load(x + i), vshift);
+      vsum = S::add(vsum, d);
+      vsumSq = S::fmadd(d, d, vsumSq);
+    }
+    sum = S::sum(vsum);
+    sumSq = S::sum(vsumSq);
+  }
+  for (; i < n; ++i) {
+    float d = x[i] - shift;
+    sum += d;
+    sumSq += d * d;
+  }
+  float m = sum / n;
+  mean = shift + m;
+  variance = std::max(0.0f, sumSq / n - m * m);
+}
+
+// sum of tanh(a + b) * v, the additive attention score of one source
+// word a and one decoder state b
+inline float RowTanhDot(const float* a, const float* b, const float* v, unsigned n) {
+  typedef SimdFloat S;
+  unsigned i = 0;
+  S::type s0 = S::set1(0.0f), s1 = s0;
+  for (; i + 2 * S::width <= n; i += 2 * S::width) {
+    s0 = S::fmadd(SimdTanh(S::add(S::load(a + i), S::load(b + i))), S::load(v + i), s0);
+    s1 = S::fmadd(SimdTanh(S::add(S::load(a + i + S::width), S::load(b + i + S::width))),
+                  S::load(v + i + S::width), s1);
+  }
+  for (; i + S::width <= n; i += S::width) {
+    s0 = S::fmadd(SimdTanh(S::add(S::load(a + i), S::load(b + i))), S::load(v + i), s0);
+  }
+  float sum = S::sum(S::add(s0, s1));
+  for (; i < n; ++i) {
+    sum += tanhapprox(a[i] + b[i]) * v[i];
+  }
+  return sum;
+}
+
+// x = gamma * (x - mean) / sigma + beta, beta may be null
+inline void RowNormalize(float* x, unsigned n, float mean, float sigma,
+                         const float* gamma, const float* beta) {
+  typedef SimdFloat S;
+  float inv = 1.0f / sigma;
+  unsigned i = 0;
+  S::type vmean = S::set1(mean);
+  S::type vinv = S::set1(inv);
+  for (; i + S::width <= n; i += S::width) {
+    S::type v = S::mul(S::mul(S::sub(S::load(x + i), vmean), vinv), S::load(gamma + i));
+    if (beta) {
+      v = S::add(v, S::load(beta + i));
+    }
+    S::store(x + i, v);
+  }
+  for (; i < n; ++i) {
+    x[i] = gamma[i] * ((x[i] - mean) * inv) + (beta ? beta[i] : 0.0f);
+  }
+}
+
+}
+}
+}
@@ -2,11 +2,16 @@
 
 #include <cmath>
 #include <iostream>
+#include <limits>
 #include <vector>
 #include <sstream>
+#include <memory>
 
 #include <blaze/Math.h>
+#include <blaze/util/policies/ArrayDelete.h>
 #include "phoenix_functions.h"
+#include "quantized.h"
+#include "simd.h"
 #include "common/base_tensor.h"
 #include "common/exception.h"
 
@@ -32,6 +37,11 @@ public:
     : Parent(rows, cols)
   {}
 
+  template <class MT, bool SO>
+  Tensor(const blaze::Matrix<MT, SO>& m)
+    : Parent(m)
+  {}
+
   template<typename T>
   Parent& operator=(const T &other) {
     return Parent::operator=(other);
@@ -175,6 +185,79 @@ class ArrayMatrix : public BlazeMatrix<float, blaze::rowMajor>
 
 };
 
+////////////////////////////////////////////////////////////////////////
+// Model weights. Either owns its elements or is a view onto memory kept
+// alive by a shared owner, e.g. a memory-mapped model file. Copies are
+// shallow, views must never be written to.
+class MappedTensor : public BaseTensor, public blaze::CustomMatrix<float, blaze::unaligned,
+                                                                   blaze::unpadded,
+                                                                   blaze::rowMajor>
+{
+  public:
+    typedef blaze::CustomMatrix<float, blaze::unaligned,
+                                blaze::unpadded,
+                                blaze::rowMajor> Parent;
+
+    MappedTensor()
+      : Parent()
+    {}
+
+    MappedTensor(unsigned rows, unsigned cols)
+      : Parent(new float[rows * cols](), rows, cols, cols, blaze::ArrayDelete())
+    {}
+
+    template <class MT, bool SO>
+    MappedTensor(const blaze::Matrix<MT, SO>& m)
+      : MappedTensor((~m).rows(), (~m).columns())
+    {
+      Parent::operator=(~m);
+    }
+
+    MappedTensor(const std::shared_ptr<const void>& owner, const float* data,
+                 unsigned rows, unsigned cols, unsigned spacing)
+      : Parent(const_cast<float*>(data), rows, cols, spacing, KeepAlive{owner})
+    {}
+
+    MappedTensor& operator=(float val) {
+      Parent::operator=(val);
+      return *this;
+    }
+
+    virtual unsigned dim(unsigned i) const
+    {
+      switch (i) {
+      case 0: return Parent::rows();
+      case 1: return Parent::columns();
+      case 2: return 1;
+      case 3: return 1;
+      default:
+        abort();
+      }
+    }
+
+    virtual void Resize(unsigned rows, unsigned cols, unsigned beam = 1, unsigned batches = 1)
+    {
+      amunmt_UTIL_THROW2("Not implemented");
+    }
+
+    // Keeps an int8 copy next to the weights, see Prod()
+    void Quantize() {
+      quantized_ = std::make_shared<QuantizedMatrix>(*this);
+    }
+
+    const QuantizedMatrix* Quantized() const {
+      return quantized_.get();
+    }
+
+  private:
+    std::shared_ptr<const QuantizedMatrix> quantized_;
+
+    struct KeepAlive {
+      void operator()(float*) const {}
+      std::shared_ptr<const void> owner;
+    };
+};
+
 ////////////////////////////////////////////////////////////////////////
 template <class M>
 std::string Debug(const M& m)
@@ -193,6 +276,55 @@ std::string Debug(const M& m)
   return strm.str();
 }
 
+// out = in * W, in int8 if the weights have been quantized
+template <class MT>
+void Prod(Tensor& out, const MT& in, const MappedTensor& W) {
+  if (W.Quantized()) {
+    out.resize(in.rows(), W.columns(), false);
+    W.Quantized()->Multiply(out, in);
+  } else {
+    out = in * W;
+  }
+}
+
+// For every row i of A the column j with the largest (A * B)(i, j) +
+// bias(0, j) in ids[i] and that value in scores[i], never choosing column
+// skip. B is multiplied a block of columns at a time and each block is
+// scanned while it is in cache, the full product is never stored.
+template <class MT1, class MT2, class MT3>
+void ProdArgMax(std::vector<unsigned>& ids, std::vector<float>& scores,
+                const MT1& A, const MT2& B, const MT3& bias, size_t skip) {
+  const size_t blockSize = 512;
+  static thread_local Tensor block;
+
+  ids.assign(A.rows(), 0);
+  scores.assign(A.rows(), std::numeric_limits<float>::lowest());
+  for (size_t start = 0; start < B.columns(); start += blockSize) {
+    size_t cols = std::min(blockSize, B.columns() - start);
+    block = A * blaze::submatrix(B, 0, start, B.rows(), cols);
+
+    for (size_t i = 0; i < block.rows(); ++i) {
+      for (size_t j = 0; j < cols; ++j) {
+        float val = block(i, j) + bias(0, start + j);
+        if (val > scores[i] && start + j != skip) {
+          scores[i] = val;
+          ids[i] = start + j;
+        }
+      }
+    }
+  }
+}
+
+template <class MT1, class MT3>
+void ProdArgMax(std::vector<unsigned>& ids, std::vector<float>& scores,
+                const MT1& A, const MappedTensor& W, const MT3& bias, size_t skip) {
+  if (W.Quantized()) {
+    W.Quantized()->ArgMax(ids, scores, A, bias, skip);
+  } else {
+    ProdArgMax(ids, scores, A, static_cast<const MappedTensor::Parent&>(W), bias, skip);
+  }
+}
+
 template <bool byRow, class MT, class VT>
 MT& AddBiasVector(MT& m, const VT& b) {
   if(byRow) {
@@ -294,11 +426,14 @@ MT Assemble(const MT1& in,
       blaze::row(out, i) = blaze::row(in, indices[i]);
   }
   else {
+    // gathered row by row, walking the input rows in storage order
+    // rather than striding over them once per column
     unsigned rows = in.rows();
     unsigned cols = indices.size();
     out.resize(rows, cols);
-    for(unsigned i = 0; i < cols; ++i)
-      blaze::column(out, i) = blaze::column(in, indices[i]);
+    for(unsigned r = 0; r < rows; ++r)
+      for(unsigned i = 0; i < cols; ++i)
+        out(r, i) = in(r, indices[i]);
   }
   return std::move(out);
 }
@@ -307,20 +442,13 @@ template <class MT>
 void SafeSoftmax(MT& Out) {
   unsigned rows = Out.rows();
   unsigned cols = Out.columns();
-  float sum[rows];
-  for (int j = 0; j < rows; ++j) {
-    float maxRowValue = 0.0f;
-    for (int i = 0; i < cols; ++i) {
-      maxRowValue = std::max(maxRowValue, Out(j,i));
-    }
-    sum[j] = 0;
-    for (int i = 0; i < cols; ++i) {
-      Out(j, i) = expapprox(Out(j, i) - maxRowValue);
-      sum[j] += Out(j, i);
-    }
-    for(int i = 0; i < cols; ++i) {
-      Out(j, i) /= sum[j];
-    }
+  if (cols == 0) {
+    return;
+  }
+  for (unsigned j = 0; j < rows; ++j) {
+    float* row = &Out(j, 0);
+    float sum = RowExpSum(row, cols, RowMax(row, cols), row);
+    RowAffine(row, cols, 1.0f / sum, 0.0f);
   }
 }
 
@@ -328,39 +456,20 @@ template <class MT>
 void LogSoftmax(MT& Out) {
   unsigned rows = Out.rows();
   unsigned cols = Out.columns();
-  float sum[rows];
-  for (int j = 0; j < rows; ++j) {
-    sum[j] = 0;
-    for (int i = 0; i < cols; ++i) {
-      sum[j] += expapprox(Out(j, i));
-    }
-    for(int i = 0; i < cols; ++i) {
-      Out(j, i) -= logapprox(sum[j]);
-    }
+  if (cols == 0) {
+    return;
+  }
+  for (unsigned j = 0; j < rows; ++j) {
+    float* row = &Out(j, 0);
+    float max, sum;
+    RowMaxExpSum(row, cols, max, sum);
+    RowAffine(row, cols, 1.0f, -(max + logapprox(sum)));
   }
 }
 
 template <class MT>
 void Softmax(MT& Out) {
-  unsigned rows = Out.rows();
-  unsigned cols = Out.columns();
-  float sum[rows];
-  for (int j = 0; j < rows; ++j) {
-    float maxRowValue = 0.0f;
-    for (int i = 0; i < cols; ++i) {
-      maxRowValue = std::max(maxRowValue, Out(j,i));
-    }
-
-    sum[j] = 0;
-    for (int i = 0; i < cols; ++i) {
-      Out(j,i) = expapprox(Out(j, i) - maxRowValue);
-      sum[j] += Out(j, i);
-    }
-
-    for(int i = 0; i < cols; ++i) {
-      Out(j, i) /= sum[j];
-    }
-  }
+  SafeSoftmax(Out);
 }
 
 template <class MT, class Functor, class MT1, class MT2>
@@ -383,79 +492,72 @@ MT Broadcast(const Functor& functor, const MT1& m1, const MT2& m2) {
   return std::move(out);
 }
 
-template<class MT>
-void LayerNormalization(MT& in, const MT& gamma, const MT& beta, float eps=1e-5f) {
-  eps=1e-5f;
-  // std::cerr << "LAYER NORM" << std::endl;
-  // std::cerr << std::endl;
-  unsigned rows = in.rows();
-  unsigned cols = in.columns();
-
-  for (int j = 0; j < rows; ++j) {
-    // std::cerr << "PRE ";
-    // for (int i = 0; i < 10; ++i) {
-      // std::cerr << in(j, i) << " ";
-    // }
-    // std::cerr << std::endl;
-    //
-    float sum = 0.0f;
-    for (int i = 0; i < cols; ++i) {
-      sum += in(j, i);
-    }
-
-    float mean = sum / cols;
-
-    float sigma = 0.0f;
-    for (int i = 0; i < cols; ++i) {
-      sigma += (in(j, i) - mean) * (in(j, i) - mean);
-    }
-    sigma /= cols;
-
-    sigma = sqrt(sigma + eps);
-
-    // std::cerr << "MIDD ";
-    // for (int i = 0; i < 10; ++i) {
-      // std::cerr << ( (in(j, i) - mean) / sigma) << " ";
-    // }
-    // std::cerr << std::endl;
-
-    for (int i = 0; i < cols; ++i) {
-      in(j, i) = gamma(i, 0) * ( (in(j, i) - mean) / sigma) + beta(i, 0);
+// Additive attention scores out(j, k) = tanh(keys(k) + queries(j)) * v
+// for every query row j and key row k. Same result as
+// Broadcast(Tanh(), keys, queries) * v, without the broadcast matrix.
+template <class MT1, class MT2, class MT3>
+void AdditiveAttention(MT1& out, const MT2& keys, const MT3& queries, const ColumnVector& v) {
+  assert(out.rows() == queries.rows() && out.columns() == keys.rows());
+  unsigned cols = keys.columns();
+  for (unsigned j = 0; j < queries.rows(); ++j) {
+    const float* query = &queries(j, 0);
+    for (unsigned k = 0; k < keys.rows(); ++k) {
+      out(j, k) = RowTanhDot(&keys(k, 0), query, v.data(), cols);
     }
+  }
+}
 
-    // std::cerr << "POST ";
-    // for (int i = 0; i < 10; ++i) {
-      // std::cerr << in(j, i) << " ";
-    // }
-    // std::cerr << std::endl;
+// Contiguous elements of a row or column vector, copied into buffer if
+// the vector is a strided column
+template <class MT>
+const float* VectorData(const MT& v, std::vector<float>& buffer) {
+  if (v.rows() == 1 || v.spacing() == 1) {
+    return &v(0, 0);
+  }
+  buffer.resize(v.rows());
+  for (unsigned i = 0; i < v.rows(); ++i) {
+    buffer[i] = v(i, 0);
   }
-  // std::cerr << "LAYER NORM: DONE" << std::endl;
+  return buffer.data();
 }
 
-template<class MT>
-void LayerNormalization(MT& in, const MT& gamma, float eps=1e-9) {
+template<class MT, class MT1, class MT2>
+void LayerNormalization(MT& in, const MT1& gamma, const MT2& beta, float eps=1e-5f) {
+  eps=1e-5f;
   unsigned rows = in.rows();
   unsigned cols = in.columns();
+  if (cols == 0) {
+    return;
+  }
 
-  for (int j = 0; j < rows; ++j) {
-    float sum = 0.0f;
-    for (int i = 0; i < cols; ++i) {
-      sum += in(j, i);
-    }
+  static thread_local std::vector<float> gammaBuffer, betaBuffer;
+  const float* gammaData = VectorData(gamma, gammaBuffer);
+  const float* betaData = VectorData(beta, betaBuffer);
 
-    float mean = sum / cols;
+  for (unsigned j = 0; j < rows; ++j) {
+    float* row = &in(j, 0);
+    float mean, variance;
+    RowMeanVariance(row, cols, mean, variance);
+    RowNormalize(row, cols, mean, std::sqrt(variance + eps), gammaData, betaData);
+  }
+}
 
-    float sigma = 0.0f;
-    for (int i = 0; i < cols; ++i) {
-      sigma += (in(j, i) - mean) * (in(j, i) - mean);
-    }
-    sigma /= cols;
+template<class MT, class MT1>
+void LayerNormalization(MT& in, const MT1& gamma, float eps=1e-9) {
+  unsigned rows = in.rows();
+  unsigned cols = in.columns();
+  if (cols == 0) {
+    return;
+  }
 
-    sigma = sqrt(sigma + eps);
+  static thread_local std::vector<float> gammaBuffer;
+  const float* gammaData = VectorData(gamma, gammaBuffer);
 
-    for (int i = 0; i < cols; ++i) {
-      in(j, i) = gamma(i, 0) * ( (in(j, i) - mean) / sigma);
-    }
+  for (unsigned j = 0; j < rows; ++j) {
+    float* row = &in(j, 0);
+    float mean, variance;
+    RowMeanVariance(row, cols, mean, variance);
+    RowNormalize(row, cols, mean, std::sqrt(variance + eps), gammaData, nullptr);
   }
 }
 
@@ -5,6 +5,7 @@
 #include "gru.h"
 #include "transition.h"
 #include "common/god.h"
+#include "cpu/decoder/shortlist_cache.h"
 
 namespace amunmt {
 namespace CPU {
@@ -54,17 +55,21 @@ class Decoder {
         void InitializeState(
           mblas::Tensor& State,
           const mblas::Tensor& SourceContext,
-          const size_t batchSize = 1)
+          const size_t batchSize,
+          const std::vector<unsigned>& sentenceLengths)
         {
           using namespace mblas;
+          assert(batchSize == sentenceLengths.size());
 
-          // Calculate mean of source context, rowwise
-          // Repeat mean batchSize times by broadcasting
-          Temp1_ = Mean<byRow, Tensor>(SourceContext);
-
+          // Calculate mean of each sentence's source context, rowwise,
+          // ignoring the padding at the end of its block
+          size_t maxLength = SourceContext.rows() / batchSize;
           Temp2_.resize(batchSize, SourceContext.columns());
-          Temp2_ = 0.0f;
-          AddBiasVector<byRow>(Temp2_, Temp1_);
+          for (size_t i = 0; i < batchSize; ++i) {
+            Temp1_ = Mean<byRow, Tensor>(blaze::submatrix(SourceContext, i * maxLength, 0,
+                                                          sentenceLengths[i], SourceContext.columns()));
+            blaze::row(Temp2_, i) = blaze::row(Temp1_, 0);
+          }
 
           State = Temp2_ * w_.Wi_;
           AddBiasVector<byRow>(State, w_.Bi_);
@@ -141,29 +146,50 @@ class Decoder {
         void GetAlignedSourceContext(
           mblas::Tensor& AlignedSourceContext,
           const mblas::Tensor& HiddenState,
-          const mblas::Tensor& SourceContext)
+          const mblas::Tensor& SourceContext,
+          const std::vector<unsigned>& sentenceLengths,
+          const std::vector<unsigned>& beamSizes)
         {
           using namespace mblas;
 
-          Temp2_ = HiddenState * w_.W_;
+          Prod(Temp2_, HiddenState, w_.W_);
           if (w_.W_comb_lns_.rows()) {
             LayerNormalization(Temp2_, w_.W_comb_lns_, w_.W_comb_lnb_);
           }
 
-          Temp1_ = Broadcast<Tensor>(Tanh(), SCU_, Temp2_);
+          // Every sentence of the batch owns a block of maxLength rows in
+          // SourceContext and beamSizes[i] consecutive rows in HiddenState.
+          // Attention is only computed over the sentence's own words,
+          // columns past its length stay 0.
+          size_t batchSize = sentenceLengths.size();
+          size_t maxLength = SourceContext.rows() / batchSize;
+          size_t cols = SourceContext.columns();
+
+          A_.resize(HiddenState.rows(), maxLength);
+          A_ = 0.0f;
+          AlignedSourceContext.resize(HiddenState.rows(), cols);
+
+          size_t hypStart = 0;
+          for (size_t i = 0; i < batchSize; ++i) {
+            size_t hyps = beamSizes[i];
+            size_t words = sentenceLengths[i];
+            if (hyps == 0) {
+              continue;
+            }
 
-          A_.resize(Temp1_.rows(), 1);
-          blaze::column(A_, 0) = Temp1_ * V_;
-          size_t words = SourceContext.rows();
-          // batch size, for batching, divide by numer of sentences
-          size_t batchSize = HiddenState.rows();
-          Reshape(A_, batchSize, words); // due to broadcasting above
+            auto A = blaze::submatrix(A_, hypStart, 0, hyps, words);
+            AdditiveAttention(A,
+                              blaze::submatrix(SCU_, i * maxLength, 0, words, SCU_.columns()),
+                              blaze::submatrix(Temp2_, hypStart, 0, hyps, Temp2_.columns()),
+                              V_);
 
-          float bias = w_.C_(0,0);
-          blaze::forEach(A_, [=](float x) { return x + bias; });
+            mblas::SafeSoftmax(A);
+            blaze::submatrix(AlignedSourceContext, hypStart, 0, hyps, cols)
+              = A * blaze::submatrix(SourceContext, i * maxLength, 0, words, cols);
 
-          mblas::SafeSoftmax(A_);
-          AlignedSourceContext = A_ * SourceContext;
+            hypStart += hyps;
+          }
+          assert(hypStart == HiddenState.rows());
         }
 
         void GetAttention(mblas::Tensor& Attention) {
@@ -178,7 +204,6 @@ class Decoder {
         const Weights& w_;
 
         mblas::Tensor SCU_;
-        mblas::Tensor Temp1_;
         mblas::Tensor Temp2_;
         mblas::Tensor A_;
         mblas::ColumnVector V_;
@@ -190,16 +215,30 @@ class Decoder {
       public:
         Softmax(const Weights& model)
         : w_(model),
-          filtered_(false)
+          greedy_(false),
+          skip_(-1)
         {}
 
+        // From now on only the best word of every row, never UNK if
+        // forbidUNK
+        void SetGreedy(bool forbidUNK) {
+          greedy_ = true;
+          skip_ = forbidUNK ? UNK_ID : -1;
+        }
+
+        // Keep the filtered output layers of the last capacity shortlists
+        void SetShortlistCache(size_t capacity) {
+          shortlists_.SetCapacity(capacity);
+        }
+
         void GetProbs(mblas::ArrayMatrix& Probs,
                   const mblas::Tensor& State,
                   const mblas::Tensor& Embedding,
-                  const mblas::Tensor& AlignedSourceContext) {
+                  const mblas::Tensor& AlignedSourceContext,
+                  bool useFusedSoftmax) {
           using namespace mblas;
 
-          T1_ = State * w_.W1_;
+          Prod(T1_, State, w_.W1_);
           AddBiasVector<byRow>(T1_, w_.B1_);
           if (w_.lns_1_.rows()) {
             LayerNormalization(T1_, w_.lns_1_, w_.lnb_1_);
@@ -208,7 +247,7 @@ class Decoder {
           // for(int i = 0; i < 5; ++i) std::cerr << T1_(0, i) << " ";
           // std::cerr << std::endl;
 
-          T2_ = Embedding * w_.W2_;
+          Prod(T2_, Embedding, w_.W2_);
           AddBiasVector<byRow>(T2_, w_.B2_);
           if (w_.lns_2_.rows()) {
             LayerNormalization(T2_, w_.lns_2_, w_.lnb_2_);
@@ -217,7 +256,7 @@ class Decoder {
           // for(int i = 0; i < 5; ++i) std::cerr << T2_(0, i) << " ";
           // std::cerr << std::endl;
 
-          T3_ = AlignedSourceContext * w_.W3_;
+          Prod(T3_, AlignedSourceContext, w_.W3_);
           AddBiasVector<byRow>(T3_, w_.B3_);
           if (w_.lns_3_.rows()) {
             LayerNormalization(T3_, w_.lns_3_, w_.lnb_3_);
@@ -228,32 +267,83 @@ class Decoder {
 
           auto t = blaze::forEach(T1_ + T2_ + T3_, Tanh());
 
+          if (greedy_) {
+            T1_ = t;
+            if (!filtered_) {
+              ProdArgMax(BestWords_, BestScores_, T1_, w_.W4_, w_.B4_, skip_);
+            } else if (!filtered_->W4q.empty()) {
+              filtered_->W4q.ArgMax(BestWords_, BestScores_, T1_, filtered_->B4, skip_);
+            } else {
+              ProdArgMax(BestWords_, BestScores_, T1_, filtered_->W4, filtered_->B4, skip_);
+            }
+            return;
+          }
+
           if(!filtered_) {
-            Probs = t * w_.W4_;
+            if (w_.W4_.Quantized()) {
+              Probs.Resize(t.rows(), w_.W4_.columns());
+              w_.W4_.Quantized()->Multiply(Probs, t);
+            } else {
+              Probs = t * w_.W4_;
+            }
             AddBiasVector<byRow>(Probs, w_.B4_);
           } else {
-            Probs = t * FilteredW4_;
-            AddBiasVector<byRow>(Probs, FilteredB4_);
+            if (!filtered_->W4q.empty()) {
+              Probs.Resize(t.rows(), filtered_->W4q.columns());
+              filtered_->W4q.Multiply(Probs, t);
+            } else {
+              Probs = t * filtered_->W4;
+            }
+            AddBiasVector<byRow>(Probs, filtered_->B4);
           }
           // std::cerr << "LOgit" << std::endl;
           // for(int i = 0; i < 5; ++i) std::cerr << Probs(0, i) << " ";
           // std::cerr << std::endl;
-          LogSoftmax(Probs);
+          // the fused beam search normalizes while it selects
+          if (!useFusedSoftmax) {
+            LogSoftmax(Probs);
+          }
         }
 
         void Filter(const std::vector<unsigned>& ids) {
-          filtered_ = true;
-          using namespace mblas;
-          FilteredW4_ = Assemble<byColumn, Tensor>(w_.W4_, ids);
-          FilteredB4_ = Assemble<byColumn, Tensor>(w_.B4_, ids);
+          filtered_ = shortlists_.Get(ids, [this](const std::vector<unsigned>& ids) {
+            using namespace mblas;
+            std::shared_ptr<FilteredOutput> out(new FilteredOutput());
+            if (w_.W4_.Quantized()) {
+              out->W4q = w_.W4_.Quantized()->Columns(ids);
+            } else {
+              out->W4 = Assemble<byColumn, Tensor>(w_.W4_, ids);
+            }
+            out->B4 = Assemble<byColumn, Tensor>(w_.B4_, ids);
+            return out;
+          });
+        }
+
+        const std::vector<unsigned>& GetBestWords() const {
+          return BestWords_;
+        }
+
+        const std::vector<float>& GetBestScores() const {
+          return BestScores_;
         }
 
       private:
         const Weights& w_;
-        bool filtered_;
+        bool greedy_;
+        size_t skip_;
+
+        std::vector<unsigned> BestWords_;
+        std::vector<float> BestScores_;
+
+        // output layer restricted to the columns of a shortlist
+        struct FilteredOutput {
+          mblas::Tensor W4;
+          mblas::QuantizedMatrix W4q;
+          mblas::Tensor B4;
+        };
 
-        mblas::Tensor FilteredW4_;
-        mblas::Tensor FilteredB4_;
+        std::shared_ptr<const FilteredOutput> filtered_;
+        ShortlistCache<FilteredOutput> shortlists_;
 
         mblas::Tensor T1_;
         mblas::Tensor T2_;
@@ -273,14 +363,18 @@ class Decoder {
       mblas::Tensor& NextState,
       const mblas::Tensor& State,
       const mblas::Tensor& Embeddings,
-      const mblas::Tensor& SourceContext)
+      const mblas::Tensor& SourceContext,
+      const std::vector<unsigned>& sentenceLengths,
+      const std::vector<unsigned>& beamSizes,
+      bool useFusedSoftmax)
     {
       GetHiddenState(HiddenState_, State, Embeddings);
       // std::cerr << "HIDDEN: " << std::endl;
       // for (int i = 0; i < 5; ++i) std::cerr << HiddenState_(0, i) << " ";
       // std::cerr << std::endl;
 
-      GetAlignedSourceContext(AlignedSourceContext_, HiddenState_, SourceContext);
+      GetAlignedSourceContext(AlignedSourceContext_, HiddenState_, SourceContext,
+                              sentenceLengths, beamSizes);
       // std::cerr << "ALIGNED SRC: " << std::endl;
       // for (int i = 0; i < 5; ++i) std::cerr << AlignedSourceContext_(0, i) << " ";
       // std::cerr << std::endl;
@@ -290,17 +384,34 @@ class Decoder {
       // for (int i = 0; i < 5; ++i) std::cerr << NextState(0, i) << " ";
       // std::cerr << std::endl;
 
-      GetProbs(NextState, Embeddings, AlignedSourceContext_);
+      GetProbs(NextState, Embeddings, AlignedSourceContext_, useFusedSoftmax);
     }
 
     mblas::ArrayMatrix& GetProbs() {
       return Probs_;
     }
 
+    void SetGreedy(bool forbidUNK) {
+      softmax_.SetGreedy(forbidUNK);
+    }
+
+    void SetShortlistCache(size_t capacity) {
+      softmax_.SetShortlistCache(capacity);
+    }
+
+    const std::vector<unsigned>& GetBestWords() const {
+      return softmax_.GetBestWords();
+    }
+
+    const std::vector<float>& GetBestScores() const {
+      return softmax_.GetBestScores();
+    }
+
     void EmptyState(mblas::Tensor& State,
                     const mblas::Tensor& SourceContext,
-                    size_t batchSize = 1) {
-    	rnn1_.InitializeState(State, SourceContext, batchSize);
+                    size_t batchSize,
+                    const std::vector<unsigned>& sentenceLengths) {
+    	rnn1_.InitializeState(State, SourceContext, batchSize, sentenceLengths);
     	attention_.Init(SourceContext);
     }
 
@@ -341,8 +452,11 @@ class Decoder {
 
     void GetAlignedSourceContext(mblas::Tensor& AlignedSourceContext,
                                  const mblas::Tensor& HiddenState,
-                                 const mblas::Tensor& SourceContext) {
-    	attention_.GetAlignedSourceContext(AlignedSourceContext, HiddenState, SourceContext);
+                                 const mblas::Tensor& SourceContext,
+                                 const std::vector<unsigned>& sentenceLengths,
+                                 const std::vector<unsigned>& beamSizes) {
+    	attention_.GetAlignedSourceContext(AlignedSourceContext, HiddenState, SourceContext,
+    	                                   sentenceLengths, beamSizes);
     }
 
     void GetNextState(mblas::Tensor& State,
@@ -354,8 +468,9 @@ class Decoder {
 
     void GetProbs(const mblas::Tensor& State,
                   const mblas::Tensor& Embedding,
-                  const mblas::Tensor& AlignedSourceContext) {
-      softmax_.GetProbs(Probs_, State, Embedding, AlignedSourceContext);
+                  const mblas::Tensor& AlignedSourceContext,
+                  bool useFusedSoftmax) {
+      softmax_.GetProbs(Probs_, State, Embedding, AlignedSourceContext, useFusedSoftmax);
     }
 
   private:
@@ -1,29 +1,51 @@
 #include "encoder.h"
 
+#include <thread>
+
+#include "common/sentences.h"
+
 using namespace std;
 
 namespace amunmt {
 namespace CPU {
 namespace Nematus {
 
-void Encoder::GetContext(const std::vector<unsigned>& words, mblas::Tensor& context) {
-  std::vector<mblas::Tensor> embeddedWords;
-
-  context.resize(words.size(),
-                 forwardRnn_.GetStateLength() + backwardRnn_.GetStateLength());
-
-  for (auto& w : words) {
-    embeddedWords.emplace_back();
-    mblas::Tensor &embed = embeddedWords.back();
-    embeddings_.Lookup(embed, w);
+// Encodes every sentence of the batch into its own block of maxLength rows.
+// Rows past the end of a shorter sentence are zero and must be masked out
+// using sentenceLengths.
+void Encoder::GetContext(const Sentences& sources, unsigned tab,
+                         mblas::Tensor& context,
+                         std::vector<unsigned>& sentenceLengths) {
+  size_t maxLength = 0;
+  sentenceLengths.resize(sources.size());
+  starts_.resize(sources.size());
+  words_.clear();
+  for (size_t i = 0; i < sources.size(); ++i) {
+    const Words& words = sources.Get(i).GetWords(tab);
+    sentenceLengths[i] = words.size();
+    starts_[i] = words_.size();
+    words_.insert(words_.end(), words.begin(), words.end());
+    maxLength = std::max<size_t>(maxLength, sentenceLengths[i]);
   }
 
-  forwardRnn_.GetContext(embeddedWords.cbegin(),
-						 embeddedWords.cend(),
-						 context, false);
-  backwardRnn_.GetContext(embeddedWords.crbegin(),
-						  embeddedWords.crend(),
-						  context, true);
+  size_t cols = forwardRnn_.GetStateLength() + backwardRnn_.GetStateLength();
+  context.resize(sources.size() * maxLength, cols);
+  context = 0.0f;
+
+  embeddings_.Lookup(Embeddings_, words_);
+
+  // The two directions only share read-only inputs and write disjoint
+  // columns of context. Short inputs are not worth a thread.
+  if (words_.size() >= 16) {
+    std::thread backward([&] {
+      backwardRnn_.GetContext(Embeddings_, starts_, sentenceLengths, maxLength, context, true);
+    });
+    forwardRnn_.GetContext(Embeddings_, starts_, sentenceLengths, maxLength, context, false);
+    backward.join();
+  } else {
+    forwardRnn_.GetContext(Embeddings_, starts_, sentenceLengths, maxLength, context, false);
+    backwardRnn_.GetContext(Embeddings_, starts_, sentenceLengths, maxLength, context, true);
+  }
 }
 
 }  // namespace Nematus
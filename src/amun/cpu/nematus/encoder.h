@@ -6,6 +6,9 @@
 #include "transition.h"
 
 namespace amunmt {
+
+class Sentences;
+
 namespace CPU {
 namespace Nematus {
 
@@ -20,16 +23,18 @@ class Encoder {
         : w_(model)
         {}
 
-        void Lookup(mblas::Tensor& Row, size_t i) {
-		  size_t len = w_.E_.columns();
-          if(i < w_.E_.rows())
-            Row = blaze::submatrix(w_.E_, i, 0, 1, len);
-          else
-            Row = blaze::submatrix(w_.E_, 1, 0, 1, len); // UNK
+        // Rows of the embeddings of words, unknown ids map to UNK
+        void Lookup(mblas::Tensor& Rows, const std::vector<unsigned>& words) {
+          ids_.resize(words.size());
+          for (size_t i = 0; i < words.size(); ++i) {
+            ids_[i] = words[i] < w_.E_.rows() ? words[i] : UNK_ID;
+          }
+          Rows = mblas::Assemble<mblas::byRow, mblas::Tensor>(w_.E_, ids_);
         }
 
         const Weights& w_;
       private:
+        std::vector<unsigned> ids_;
     };
 
     /////////////////////////////////////////////////////////////////
@@ -46,34 +51,46 @@ class Encoder {
           State_ = 0.0f;
         }
 
-        void GetNextState(mblas::Tensor& nextState,
-                          const mblas::Tensor& state,
-                          const mblas::Tensor& embd) {
-          gru_.GetNextState(nextState, state, embd);
-          // std::cerr << "GRU: " << std::endl;
-          // for (int i = 0; i < 10; ++i) std::cerr << nextState(0, i) << " ";
-          // std::cerr << std::endl;
-          transition_.GetNextState(nextState);
-          // std::cerr << "TRANS: " << std::endl;
-          // for (int i = 0; i < 10; ++i) std::cerr << nextState(0, i) << " ";
-          // std::cerr << std::endl;
-        }
-
-        template <class It>
-        void GetContext(It it, It end, mblas::Tensor& Context, bool invert) {
-          InitializeState();
-
-          size_t n = std::distance(it, end);
-          size_t i = 0;
-          while(it != end) {
-          GetNextState(State_, State_, *it++);
-
+        // Runs over all sentences of a batch together, one row of the state
+        // per sentence. Embeddings holds the words of every sentence one after
+        // the other, sentence i starting at row starts[i]. Its states go to
+        // the block of maxLength rows of sentence i in Context, into the left
+        // half of the columns or, reading right to left, into the right half.
+        void GetContext(const mblas::Tensor& Embeddings,
+                        const std::vector<size_t>& starts,
+                        const std::vector<unsigned>& lengths,
+                        size_t maxLength,
+                        mblas::Tensor& Context,
+                        bool invert) {
+          size_t batchSize = lengths.size();
           size_t len = gru_.GetStateLength();
-            if(invert)
-              blaze::submatrix(Context, n - i - 1, len, 1, len) = State_;
-            else
-      			  blaze::submatrix(Context, i, 0, 1, len) = State_;
-            ++i;
+          InitializeState(batchSize);
+
+          // the input projections of all timesteps in one product
+          gru_.ProjectInput(Inputs_, Embeddings);
+          StepInputs_.resize(batchSize, Inputs_.columns());
+
+          for (size_t t = 0; t < maxLength; ++t) {
+            for (size_t i = 0; i < batchSize; ++i) {
+              if (t < lengths[i]) {
+                size_t word = invert ? lengths[i] - t - 1 : t;
+                blaze::row(StepInputs_, i) = blaze::row(Inputs_, starts[i] + word);
+              } else {
+                // finished sentence, its state is not used any more
+                blaze::row(StepInputs_, i) = 0.0f;
+              }
+            }
+
+            gru_.GetNextStateFromInput(State_, State_, StepInputs_);
+            transition_.GetNextState(State_);
+
+            for (size_t i = 0; i < batchSize; ++i) {
+              if (t < lengths[i]) {
+                size_t word = invert ? lengths[i] - t - 1 : t;
+                blaze::submatrix(Context, i * maxLength + word, invert ? len : 0, 1, len)
+                  = blaze::submatrix(State_, i, 0, 1, len);
+              }
+            }
           }
         }
 
@@ -87,6 +104,8 @@ class Encoder {
         const Transition transition_;
 
         mblas::Tensor State_;
+        mblas::Tensor Inputs_;
+        mblas::Tensor StepInputs_;
     };
 
   /////////////////////////////////////////////////////////////////
@@ -97,13 +116,20 @@ class Encoder {
         backwardRnn_(model.encBackwardGRU_, model.encBackwardTransition_)
     {}
 
-    void GetContext(const std::vector<unsigned>& words,
-                    mblas::Tensor& context);
+    void GetContext(const Sentences& sources,
+                    unsigned tab,
+                    mblas::Tensor& context,
+                    std::vector<unsigned>& sentenceLengths);
 
   private:
     Embeddings<Weights::Embeddings> embeddings_;
     EncoderRNN<Weights::GRU, Weights::Transition> forwardRnn_;
     EncoderRNN<Weights::GRU, Weights::Transition> backwardRnn_;
+
+    // reused to avoid allocation
+    mblas::Tensor Embeddings_;
+    std::vector<unsigned> words_;
+    std::vector<size_t> starts_;
 };
 
 }
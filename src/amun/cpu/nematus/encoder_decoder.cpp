@@ -26,28 +26,33 @@ EncoderDecoder::EncoderDecoder(const God &god,
     model_(model),
     encoder_(new CPU::Nematus::Encoder(model_)),
     decoder_(new CPU::Nematus::Decoder(model_))
-{}
+{
+  if (UseGreedy(god)) {
+    decoder_->SetGreedy(!god.GetOptions().allowUnk);
+  }
+  decoder_->SetShortlistCache(god.Get<unsigned>("softmax-filter-cache"));
+}
 
 
-void EncoderDecoder::Decode(const State& in, State& out, const std::vector<unsigned>&) {
+void EncoderDecoder::Decode(const State& in, State& out, const std::vector<unsigned>& beamSizes) {
   const EDState& edIn = in.get<EDState>();
   EDState& edOut = out.get<EDState>();
 
   decoder_->Decode(edOut.GetStates(), edIn.GetStates(),
-                   edIn.GetEmbeddings(), SourceContext_);
+                   edIn.GetEmbeddings(), SourceContext_,
+                   sentenceLengths_, beamSizes, god_.UseFusedSoftmax());
 }
 
 
 void EncoderDecoder::BeginSentenceState(State& state, unsigned batchSize) {
   EDState& edState = state.get<EDState>();
-  decoder_->EmptyState(edState.GetStates(), SourceContext_, batchSize);
+  decoder_->EmptyState(edState.GetStates(), SourceContext_, batchSize, sentenceLengths_);
   decoder_->EmptyEmbedding(edState.GetEmbeddings(), batchSize);
 }
 
 
 void EncoderDecoder::Encode(const Sentences& sources) {
-  encoder_->GetContext(sources.Get(0).GetWords(tab_),
-                        SourceContext_);
+  encoder_->GetContext(sources, tab_, SourceContext_, sentenceLengths_);
 }
 
 
@@ -93,6 +98,14 @@ BaseTensor& EncoderDecoder::GetProbs() {
   return decoder_->GetProbs();
 }
 
+const std::vector<unsigned>& EncoderDecoder::GetBestWords() const {
+  return decoder_->GetBestWords();
+}
+
+const std::vector<float>& EncoderDecoder::GetBestScores() const {
+  return decoder_->GetBestScores();
+}
+
 }
 }
 }
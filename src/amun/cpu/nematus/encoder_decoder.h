@@ -45,6 +45,9 @@ class EncoderDecoder : public CPUEncoderDecoderBase {
 
     BaseTensor& GetProbs();
 
+    const std::vector<unsigned>& GetBestWords() const;
+    const std::vector<float>& GetBestScores() const;
+
     void Filter(const std::vector<unsigned>& filterIds);
 
   protected:
@@ -15,6 +15,10 @@ class GRU {
       if (!layerNormalization_) {
         WWx_ = mblas::Concat<mblas::byColumn, mblas::Tensor>(w_.W_, w_.Wx_);
         UUx_ = mblas::Concat<mblas::byColumn, mblas::Tensor>(w_.U_, w_.Ux_);
+        if (w_.U_.Quantized()) {
+          WWxq_ = mblas::QuantizedMatrix(WWx_);
+          UUxq_ = mblas::QuantizedMatrix(UUx_);
+        }
       }
     }
 
@@ -23,38 +27,64 @@ class GRU {
       const mblas::Tensor& state,
       const mblas::Tensor& context) const
     {
-      // std::cerr << "Get next state" << std::endl;
+      ProjectInput(RUH_, context);
+      GetNextStateFromInput(nextState, state, RUH_);
+    }
+
+    // Input side of the GRU, one row per row of context. Does not depend on
+    // the state, so the inputs of all timesteps can be projected at once.
+    void ProjectInput(mblas::Tensor& RUH, const mblas::Tensor& context) const
+    {
       if (layerNormalization_) {
-        RUH_1_ = context * w_.W_;
+        mblas::Prod(RUH_1_, context, w_.W_);
         mblas::AddBiasVector<mblas::byRow>(RUH_1_, w_.B_);
         LayerNormalization(RUH_1_, w_.W_lns_, w_.W_lnb_);
 
-        RUH_2_ = context * w_.Wx_;
+        mblas::Prod(RUH_2_, context, w_.Wx_);
         mblas::AddBiasVector<mblas::byRow>(RUH_2_, w_.Bx1_);
         LayerNormalization(RUH_2_, w_.Wx_lns_, w_.Wx_lnb_);
 
-        RUH_ = mblas::Concat<mblas::byColumn, mblas::Tensor>(RUH_1_, RUH_2_);
+        RUH = mblas::Concat<mblas::byColumn, mblas::Tensor>(RUH_1_, RUH_2_);
+      } else if (!WWxq_.empty()) {
+        RUH.resize(context.rows(), WWxq_.columns(), false);
+        WWxq_.Multiply(RUH, context);
+      } else {
+        RUH = context * WWx_;
+      }
+    }
 
-        Temp_1_ = state * w_.U_;
+    // Recurrent side of the GRU given the projected input
+    void GetNextStateFromInput(
+      mblas::Tensor& nextState,
+      const mblas::Tensor& state,
+      mblas::Tensor& RUH) const
+    {
+      if (layerNormalization_) {
+        mblas::Prod(Temp_1_, state, w_.U_);
         mblas::AddBiasVector<mblas::byRow>(Temp_1_, w_.Bx3_);
         LayerNormalization(Temp_1_, w_.U_lns_, w_.U_lnb_);
 
-        Temp_2_ = state * w_.Ux_;
+        mblas::Prod(Temp_2_, state, w_.Ux_);
         mblas::AddBiasVector<mblas::byRow>(Temp_2_, w_.Bx2_);
         LayerNormalization(Temp_2_, w_.Ux_lns_, w_.Ux_lnb_);
 
         Temp_ = mblas::Concat<mblas::byColumn, mblas::Tensor>(Temp_1_, Temp_2_);
 
-        ElementwiseOpsLayerNorm(nextState, state);
+        ElementwiseOpsLayerNorm(nextState, state, RUH);
 
       } else {
-        RUH_ = context * WWx_;
-        Temp_ = state * UUx_;
-        ElementwiseOps(nextState, state);
+        if (!UUxq_.empty()) {
+          Temp_.resize(state.rows(), UUxq_.columns(), false);
+          UUxq_.Multiply(Temp_, state);
+        } else {
+          Temp_ = state * UUx_;
+        }
+        ElementwiseOps(nextState, state, RUH);
       }
     }
 
-    void ElementwiseOps(mblas::Tensor& NextState, const mblas::Tensor& State) const {
+    void ElementwiseOps(mblas::Tensor& NextState, const mblas::Tensor& State,
+                        mblas::Tensor& RUH) const {
       using namespace mblas;
       using namespace blaze;
 
@@ -66,7 +96,7 @@ class GRU {
         auto rowOut = row(NextState, j);
         auto rowState = row(State, j);
 
-        auto rowRuh = row(RUH_, j);
+        auto rowRuh = row(RUH, j);
         auto rowT   = row(Temp_, j);
 
         auto rowH   = subvector(rowRuh, 2 * colNo, colNo);
@@ -88,7 +118,8 @@ class GRU {
       }
     }
 
-    void ElementwiseOpsLayerNorm(mblas::Tensor& NextState, const mblas::Tensor& State) const {
+    void ElementwiseOpsLayerNorm(mblas::Tensor& NextState, const mblas::Tensor& State,
+                                 mblas::Tensor& RUH) const {
       using namespace mblas;
       using namespace blaze;
 
@@ -100,7 +131,7 @@ class GRU {
         auto rowOut = row(NextState, j);
         auto rowState = row(State, j);
 
-        auto rowRuh = row(RUH_, j);
+        auto rowRuh = row(RUH, j);
         auto rowT   = row(Temp_, j);
 
         auto rowH   = subvector(rowRuh, 2 * colNo, colNo);
@@ -131,6 +162,8 @@ class GRU {
     const Weights& w_;
     mutable mblas::Tensor WWx_;
     mutable mblas::Tensor UUx_;
+    mblas::QuantizedMatrix WWxq_;
+    mblas::QuantizedMatrix UUxq_;
     mutable mblas::Tensor Wbbx_;
     mutable mblas::Tensor lns_WWx_;
     mutable mblas::Tensor lns_UUx_;
@@ -20,13 +20,13 @@ Weights::Transition::Transition(const NpzConverter& model, TransitionType type,
     switch(type) {
       case TransitionType::Encoder:
         Bx1_.emplace_back(1, Ux_.back().dim(1));
-        const_cast<mblas::Tensor&>(Bx1_.back()) = 0.0f;
+        const_cast<mblas::MappedTensor&>(Bx1_.back()) = 0.0f;
         Bx2_.emplace_back(model(name(prefix, "bx", infix, i), true));
         break;
       case TransitionType::Decoder:
         Bx1_.emplace_back(model(name(prefix, "bx", infix, i), true));
         Bx2_.emplace_back(1, Ux_.back().dim(1));
-        const_cast<mblas::Tensor&>(Bx2_.back()) = 0.0f;
+        const_cast<mblas::MappedTensor&>(Bx2_.back()) = 0.0f;
         break;
     }
   }
@@ -86,8 +86,8 @@ Weights::GRU::GRU(const NpzConverter& model, std::string prefix, std::vector<std
     Ux_lns_(model[prefix + keys.at(12)]),
     Ux_lnb_(model[prefix + keys.at(13)])
 {
-  const_cast<mblas::Tensor&>(Bx2_) = 0.0f;
-  const_cast<mblas::Tensor&>(Bx3_) = 0.0f;
+  const_cast<mblas::MappedTensor&>(Bx2_) = 0.0f;
+  const_cast<mblas::MappedTensor&>(Bx3_) = 0.0f;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -119,8 +119,8 @@ Weights::DecGRU2::DecGRU2(const NpzConverter& model, std::string prefix, std::ve
     Ux_lnb_(model[prefix + keys.at(13)])  // Ux_nl_lnb
 
 {
-  const_cast<mblas::Tensor&>(B_) = 0.0f;
-  const_cast<mblas::Tensor&>(Bx1_) = 0.0f;
+  const_cast<mblas::MappedTensor&>(B_) = 0.0f;
+  const_cast<mblas::MappedTensor&>(Bx1_) = 0.0f;
 }
 
 Weights::DecAttention::DecAttention(const NpzConverter& model)
@@ -156,7 +156,15 @@ Weights::DecSoftmax::DecSoftmax(const NpzConverter& model)
 
 //////////////////////////////////////////////////////////////////////////////
 
-Weights::Weights(const NpzConverter& model, size_t)
+namespace {
+
+void Quantize(const mblas::MappedTensor& W) {
+  const_cast<mblas::MappedTensor&>(W).Quantize();
+}
+
+}
+
+Weights::Weights(const NpzConverter& model, size_t, bool quantize)
   : encEmbeddings_(model, "Wemb"),
     decEmbeddings_(model, std::vector<std::pair<std::string, bool>>(
           {std::make_pair(std::string("Wemb_dec"), false),
@@ -176,7 +184,22 @@ Weights::Weights(const NpzConverter& model, size_t)
     encForwardTransition_(model, Weights::Transition::TransitionType::Encoder, "encoder_"),
     encBackwardTransition_(model,Weights::Transition::TransitionType::Encoder, "encoder_r_"),
     decTransition_(model, Weights::Transition::TransitionType::Decoder, "decoder_", "_nl")
-{}
+{
+  if (!quantize) {
+    return;
+  }
+
+  for (auto W : {&decGru1_.W_, &decGru1_.U_, &decGru1_.Wx_, &decGru1_.Ux_,
+                 &decGru2_.W_, &decGru2_.U_, &decGru2_.Wx_, &decGru2_.Ux_,
+                 &decAttention_.W_,
+                 &decSoftmax_.W1_, &decSoftmax_.W2_, &decSoftmax_.W3_, &decSoftmax_.W4_}) {
+    Quantize(*W);
+  }
+  for (int i = 0; i < decTransition_.size(); ++i) {
+    Quantize(decTransition_.U_[i]);
+    Quantize(decTransition_.Ux_[i]);
+  }
+}
 
 }  // namespace Nematus
 }  // namespace cpu
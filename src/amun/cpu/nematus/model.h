@@ -35,16 +35,16 @@ struct Weights {
       TransitionType type_;
 
     public:
-      std::vector<mblas::Tensor> B_;
-      std::vector<mblas::Tensor> Bx1_;
-      std::vector<mblas::Tensor> Bx2_;
-      std::vector<mblas::Tensor> U_;
-      std::vector<mblas::Tensor> Ux_;
+      std::vector<mblas::MappedTensor> B_;
+      std::vector<mblas::MappedTensor> Bx1_;
+      std::vector<mblas::MappedTensor> Bx2_;
+      std::vector<mblas::MappedTensor> U_;
+      std::vector<mblas::MappedTensor> Ux_;
 
-      std::vector<mblas::Tensor> U_lns_;
-      std::vector<mblas::Tensor> U_lnb_;
-      std::vector<mblas::Tensor> Ux_lns_;
-      std::vector<mblas::Tensor> Ux_lnb_;
+      std::vector<mblas::MappedTensor> U_lns_;
+      std::vector<mblas::MappedTensor> U_lnb_;
+      std::vector<mblas::MappedTensor> Ux_lns_;
+      std::vector<mblas::MappedTensor> Ux_lnb_;
 
   };
 
@@ -52,101 +52,102 @@ struct Weights {
     Embeddings(const NpzConverter& model, const std::string &key);
     Embeddings(const NpzConverter& model, const std::vector<std::pair<std::string, bool>> keys);
 
-    const mblas::Tensor E_;
+    const mblas::MappedTensor E_;
   };
 
   struct GRU {
     GRU(const NpzConverter& model, std::string prefix, std::vector<std::string> keys);
 
-    const mblas::Tensor W_;
-    const mblas::Tensor B_;
-    const mblas::Tensor U_;
-    const mblas::Tensor Wx_;
-    const mblas::Tensor Bx1_;
-    const mblas::Tensor Bx2_;
-    const mblas::Tensor Bx3_;
-    const mblas::Tensor Ux_;
-
-    const mblas::Tensor W_lns_;
-    const mblas::Tensor W_lnb_;
-    const mblas::Tensor Wx_lns_;
-    const mblas::Tensor Wx_lnb_;
-    const mblas::Tensor U_lns_;
-    const mblas::Tensor U_lnb_;
-    const mblas::Tensor Ux_lns_;
-    const mblas::Tensor Ux_lnb_;
+    const mblas::MappedTensor W_;
+    const mblas::MappedTensor B_;
+    const mblas::MappedTensor U_;
+    const mblas::MappedTensor Wx_;
+    const mblas::MappedTensor Bx1_;
+    const mblas::MappedTensor Bx2_;
+    const mblas::MappedTensor Bx3_;
+    const mblas::MappedTensor Ux_;
+
+    const mblas::MappedTensor W_lns_;
+    const mblas::MappedTensor W_lnb_;
+    const mblas::MappedTensor Wx_lns_;
+    const mblas::MappedTensor Wx_lnb_;
+    const mblas::MappedTensor U_lns_;
+    const mblas::MappedTensor U_lnb_;
+    const mblas::MappedTensor Ux_lns_;
+    const mblas::MappedTensor Ux_lnb_;
   };
 
   struct DecInit {
     DecInit(const NpzConverter& model);
 
-    const mblas::Tensor Wi_;
-    const mblas::Tensor Bi_;
-    const mblas::Tensor lns_;
-    const mblas::Tensor lnb_;
+    const mblas::MappedTensor Wi_;
+    const mblas::MappedTensor Bi_;
+    const mblas::MappedTensor lns_;
+    const mblas::MappedTensor lnb_;
   };
 
   struct DecGRU2 {
     DecGRU2(const NpzConverter& model, std::string prefix, std::vector<std::string> keys);
 
-    const mblas::Tensor W_;
-    const mblas::Tensor B_;
-    const mblas::Tensor U_;
-    const mblas::Tensor Wx_;
-    const mblas::Tensor Bx3_;
-    const mblas::Tensor Bx2_;
-    const mblas::Tensor Bx1_;
-    const mblas::Tensor Ux_;
-
-    const mblas::Tensor W_lns_;
-    const mblas::Tensor W_lnb_;
-    const mblas::Tensor Wx_lns_;
-    const mblas::Tensor Wx_lnb_;
-    const mblas::Tensor U_lns_;
-    const mblas::Tensor U_lnb_;
-    const mblas::Tensor Ux_lns_;
-    const mblas::Tensor Ux_lnb_;
+    const mblas::MappedTensor W_;
+    const mblas::MappedTensor B_;
+    const mblas::MappedTensor U_;
+    const mblas::MappedTensor Wx_;
+    const mblas::MappedTensor Bx3_;
+    const mblas::MappedTensor Bx2_;
+    const mblas::MappedTensor Bx1_;
+    const mblas::MappedTensor Ux_;
+
+    const mblas::MappedTensor W_lns_;
+    const mblas::MappedTensor W_lnb_;
+    const mblas::MappedTensor Wx_lns_;
+    const mblas::MappedTensor Wx_lnb_;
+    const mblas::MappedTensor U_lns_;
+    const mblas::MappedTensor U_lnb_;
+    const mblas::MappedTensor Ux_lns_;
+    const mblas::MappedTensor Ux_lnb_;
   };
 
   struct DecAttention {
     DecAttention(const NpzConverter& model);
 
-    const mblas::Tensor V_;
-    const mblas::Tensor W_;
-    const mblas::Tensor B_;
-    const mblas::Tensor U_;
-    const mblas::Tensor C_;
-    const mblas::Tensor Wc_att_lns_;
-    const mblas::Tensor Wc_att_lnb_;
-    const mblas::Tensor W_comb_lns_;
-    const mblas::Tensor W_comb_lnb_;
+    const mblas::MappedTensor V_;
+    const mblas::MappedTensor W_;
+    const mblas::MappedTensor B_;
+    const mblas::MappedTensor U_;
+    const mblas::MappedTensor C_;
+    const mblas::MappedTensor Wc_att_lns_;
+    const mblas::MappedTensor Wc_att_lnb_;
+    const mblas::MappedTensor W_comb_lns_;
+    const mblas::MappedTensor W_comb_lnb_;
   };
 
   struct DecSoftmax {
     DecSoftmax(const NpzConverter& model);
 
-    const mblas::Tensor W1_;
-    const mblas::Tensor B1_;
-    const mblas::Tensor W2_;
-    const mblas::Tensor B2_;
-    const mblas::Tensor W3_;
-    const mblas::Tensor B3_;
-    const mblas::Tensor W4_;
-    const mblas::Tensor B4_;
-    const mblas::Tensor lns_1_;
-    const mblas::Tensor lns_2_;
-    const mblas::Tensor lns_3_;
-    const mblas::Tensor lnb_1_;
-    const mblas::Tensor lnb_2_;
-    const mblas::Tensor lnb_3_;
+    const mblas::MappedTensor W1_;
+    const mblas::MappedTensor B1_;
+    const mblas::MappedTensor W2_;
+    const mblas::MappedTensor B2_;
+    const mblas::MappedTensor W3_;
+    const mblas::MappedTensor B3_;
+    const mblas::MappedTensor W4_;
+    const mblas::MappedTensor B4_;
+    const mblas::MappedTensor lns_1_;
+    const mblas::MappedTensor lns_2_;
+    const mblas::MappedTensor lns_3_;
+    const mblas::MappedTensor lnb_1_;
+    const mblas::MappedTensor lnb_2_;
+    const mblas::MappedTensor lnb_3_;
   };
 
 
-  Weights(const std::string& npzFile, size_t device = 0)
-    : Weights(NpzConverter(npzFile), device)
+  Weights(const std::string& npzFile, size_t device = 0, bool quantize = false)
+    : Weights(NpzConverter(npzFile), device, quantize)
   {}
 
-  Weights(const NpzConverter& model, size_t device = 0);
+  // quantize: keep int8 copies of the decoder and output layer weights
+  Weights(const NpzConverter& model, size_t device = 0, bool quantize = false);
 
   size_t GetDevice() {
     return std::numeric_limits<size_t>::max();
@@ -18,8 +18,8 @@ void Transition::GetNextState(mblas::Tensor& state) const
 {
   if (layerNormalization_) {
     for (int i = 0; i < w_.size(); ++i) {
-      Temp_1_ = state * w_.U_[i];
-      Temp_2_ = state * w_.Ux_[i];
+      mblas::Prod(Temp_1_, state, w_.U_[i]);
+      mblas::Prod(Temp_2_, state, w_.Ux_[i]);
 
       switch(w_.type()) {
         case Weights::Transition::TransitionType::Encoder:
@@ -41,8 +41,8 @@ void Transition::GetNextState(mblas::Tensor& state) const
     }
   } else {
     for (int i = 0; i < w_.size(); ++i) {
-      Temp_1_ = state * w_.U_[i];
-      Temp_2_ = state * w_.Ux_[i];
+      mblas::Prod(Temp_1_, state, w_.U_[i]);
+      mblas::Prod(Temp_2_, state, w_.Ux_[i]);
       mblas::AddBiasVector<mblas::byRow>(Temp_1_, w_.B_[i]);
       mblas::AddBiasVector<mblas::byRow>(Temp_2_, w_.Bx1_[i]);
       ElementwiseOps(state, i);
@@ -0,0 +1,14 @@
+#include <iostream>
+
+#include "cpu/npz_converter.h"
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " model.npz model.bin" << std::endl;
+    std::cerr << "Converts a model to the binary format amun can memory-map." << std::endl;
+    return 1;
+  }
+
+  amunmt::CPU::NpzConverter::ConvertToBinary(argv[1], argv[2]);
+  return 0;
+}
@@ -0,0 +1,255 @@
+#include "cpu/npz_converter.h"
+
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common/exception.h"
+
+namespace amunmt {
+namespace CPU {
+
+namespace {
+
+const char BINARY_MAGIC[8] = {'A', 'M', 'U', 'N', 'B', 'I', 'N', '1'};
+const size_t BINARY_ALIGNMENT = 64;
+
+size_t AlignUp(size_t val, size_t alignment) {
+  return (val + alignment - 1) / alignment * alignment;
+}
+
+template <typename T>
+void Write(std::ostream& out, const T& val) {
+  out.write(reinterpret_cast<const char*>(&val), sizeof(T));
+}
+
+uint64_t Read(const char*& pos, const char* end) {
+  amunmt_UTIL_THROW_IF2(pos + sizeof(uint64_t) > end, "Truncated binary model header");
+  uint64_t val;
+  std::memcpy(&val, pos, sizeof(uint64_t));
+  pos += sizeof(uint64_t);
+  return val;
+}
+
+}
+
+NpzConverter::NpzConverter(const std::string& file, bool copy)
+  : destructed_(false),
+    copy_(copy)
+{
+  if (IsBinary(file)) {
+    Map(file);
+  } else {
+    model_ = cnpy::npz_load(file);
+  }
+}
+
+NpzConverter::~NpzConverter() {
+  if(!destructed_)
+    model_.destruct();
+}
+
+void NpzConverter::Destruct() {
+  model_.destruct();
+  destructed_ = true;
+}
+
+bool NpzConverter::IsBinary(const std::string& file) {
+  std::ifstream in(file, std::ios::binary);
+  char magic[sizeof(BINARY_MAGIC)];
+  return in.read(magic, sizeof(magic))
+      && std::memcmp(magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0;
+}
+
+void NpzConverter::Map(const std::string& file) {
+  int fd = open(file.c_str(), O_RDONLY);
+  amunmt_UTIL_THROW_IF2(fd < 0, "Cannot open " << file);
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    amunmt_UTIL_THROW2("Cannot stat " << file);
+  }
+  size_t size = st.st_size;
+
+  void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  amunmt_UTIL_THROW_IF2(addr == MAP_FAILED, "Cannot memory-map " << file);
+  mapping_.reset(addr, [size](const void* p) { munmap(const_cast<void*>(p), size); });
+
+  const char* begin = static_cast<const char*>(addr);
+  const char* end = begin + size;
+  const char* pos = begin + sizeof(BINARY_MAGIC);
+
+  uint64_t count = Read(pos, end);
+  for (uint64_t i = 0; i < count; ++i) {
+    uint64_t nameLength = Read(pos, end);
+    amunmt_UTIL_THROW_IF2(pos + nameLength > end, "Truncated binary model header");
+    std::string name(pos, nameLength);
+    pos += nameLength;
+
+    Entry entry;
+    entry.rows = Read(pos, end);
+    entry.cols = Read(pos, end);
+    entry.spacing = Read(pos, end);
+    uint64_t offset = Read(pos, end);
+
+    size_t bytes = entry.rows ? ((entry.rows - 1) * entry.spacing + entry.cols) * sizeof(float) : 0;
+    amunmt_UTIL_THROW_IF2(offset % BINARY_ALIGNMENT || offset + bytes > size,
+                          "Corrupt binary model entry " << name << " in " << file);
+    entry.data = reinterpret_cast<const float*>(begin + offset);
+    mapped_[name] = entry;
+  }
+}
+
+bool NpzConverter::has(std::string key) const {
+  if (mapping_) {
+    return mapped_.count(key);
+  }
+  return model_.count(key);
+}
+
+bool NpzConverter::Find(const std::string& key, Entry& entry) const {
+  if (mapping_) {
+    auto it = mapped_.find(key);
+    if (it == mapped_.end()) {
+      return false;
+    }
+    entry = it->second;
+    return true;
+  }
+
+  auto it = model_.find(key);
+  if (it == model_.end()) {
+    return false;
+  }
+  const cnpy::NpyArray& npy = it->second;
+  entry.data = (const float*)npy.data;
+  entry.rows = npy.shape[0];
+  entry.cols = (npy.shape.size() == 1) ? 1 : npy.shape[1];
+  entry.spacing = entry.cols;
+  return true;
+}
+
+mblas::MappedTensor NpzConverter::Get(const Entry& entry, bool transpose) const {
+  if (mapping_ && !copy_) {
+    if (!transpose) {
+      return mblas::MappedTensor(mapping_, entry.data, entry.rows, entry.cols, entry.spacing);
+    }
+    // vectors are contiguous, transposing them only swaps the shape
+    if (entry.rows == 1) {
+      return mblas::MappedTensor(mapping_, entry.data, entry.cols, 1, 1);
+    }
+    if (entry.cols == 1) {
+      return mblas::MappedTensor(mapping_, entry.data, 1, entry.rows, entry.rows);
+    }
+  }
+
+  typedef blaze::CustomMatrix<float, blaze::unaligned,
+                              blaze::unpadded, blaze::rowMajor> BlazeWrapper;
+  BlazeWrapper matrix(const_cast<float*>(entry.data), entry.rows, entry.cols, entry.spacing);
+  if (transpose) {
+    return mblas::MappedTensor(blaze::trans(matrix));
+  }
+  return mblas::MappedTensor(matrix);
+}
+
+mblas::MappedTensor NpzConverter::operator[](const std::string& key) const {
+  Entry entry;
+  if (Find(key, entry)) {
+    return Get(entry, false);
+  }
+
+  if (key.find("gamma") == std::string::npos) {
+    std::cerr << "Missing " << key << std::endl;
+  }
+  return mblas::MappedTensor();
+}
+
+mblas::MappedTensor NpzConverter::getFirstOfMany(const std::vector<std::pair<std::string, bool>> keys) const {
+  for (auto key : keys) {
+    Entry entry;
+    if (Find(key.first, entry)) {
+      return Get(entry, key.second);
+    }
+  }
+  std::cerr << "Matrix not found: " << keys[0].first << "\n";
+  return mblas::MappedTensor();
+}
+
+mblas::MappedTensor NpzConverter::operator()(const std::string& key,
+                                             bool transpose) const {
+  Entry entry;
+  if (Find(key, entry)) {
+    return Get(entry, transpose);
+  }
+  std::cerr << "Missing " << key << std::endl;
+  return mblas::MappedTensor();
+}
+
+void NpzConverter::ConvertToBinary(const std::string& npzFile, const std::string& binFile) {
+  NpzConverter npz(npzFile);
+  amunmt_UTIL_THROW_IF2(npz.mapping_, npzFile << " is already a binary model");
+
+  std::map<std::string, mblas::MappedTensor> tensors;
+  for (auto& it : npz.model_) {
+    amunmt_UTIL_THROW_IF2(it.second.word_size != sizeof(float) || it.second.shape.size() > 2,
+                          "Only 1 and 2 dimensional float32 arrays are supported: " << it.first);
+    tensors.emplace(it.first, npz[it.first]);
+  }
+  if (!npz.has("ff_logit_W") && (npz.has("Wemb_dec") || npz.has("Wemb"))) {
+    tensors.emplace("ff_logit_W", npz.getFirstOfMany({std::make_pair(std::string("Wemb_dec"), true),
+                                                      std::make_pair(std::string("Wemb"), true)}));
+  }
+
+  std::ofstream out(binFile, std::ios::binary);
+  amunmt_UTIL_THROW_IF2(!out, "Cannot write " << binFile);
+
+  size_t headerSize = sizeof(BINARY_MAGIC) + sizeof(uint64_t);
+  for (auto& it : tensors) {
+    headerSize += 5 * sizeof(uint64_t) + it.first.size();
+  }
+
+  out.write(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+  Write<uint64_t>(out, tensors.size());
+
+  std::vector<size_t> spacings;
+  size_t offset = AlignUp(headerSize, BINARY_ALIGNMENT);
+  for (auto& it : tensors) {
+    const mblas::MappedTensor& tensor = it.second;
+    bool isVector = tensor.rows() == 1 || tensor.columns() == 1;
+    size_t spacing = isVector ? tensor.columns()
+                              : AlignUp(tensor.columns(), BINARY_ALIGNMENT / sizeof(float));
+    spacings.push_back(spacing);
+
+    Write<uint64_t>(out, it.first.size());
+    out.write(it.first.data(), it.first.size());
+    Write<uint64_t>(out, tensor.rows());
+    Write<uint64_t>(out, tensor.columns());
+    Write<uint64_t>(out, spacing);
+    Write<uint64_t>(out, offset);
+
+    offset = AlignUp(offset + tensor.rows() * spacing * sizeof(float), BINARY_ALIGNMENT);
+  }
+
+  size_t i = 0;
+  std::vector<float> row;
+  for (auto& it : tensors) {
+    const mblas::MappedTensor& tensor = it.second;
+    out.seekp(AlignUp(out.tellp(), BINARY_ALIGNMENT));
+    row.assign(spacings[i++], 0.0f);
+    for (size_t r = 0; r < tensor.rows(); ++r) {
+      for (size_t c = 0; c < tensor.columns(); ++c) {
+        row[c] = tensor(r, c);
+      }
+      out.write(reinterpret_cast<const char*>(row.data()), row.size() * sizeof(float));
+    }
+  }
+  amunmt_UTIL_THROW_IF2(!out, "Error writing " << binFile);
+}
+
+}
+}
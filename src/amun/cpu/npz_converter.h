@@ -1,137 +1,70 @@
 #pragma once
 
+#include <map>
+#include <memory>
+
 #include "cnpy/cnpy.h"
 #include "mblas/tensor.h"
 
 namespace amunmt {
 namespace CPU {
 
+// Reads model weights either from a numpy .npz archive or from the native
+// binary format written by ConvertToBinary. The format is detected from the
+// file contents. Binary models are memory-mapped read-only and the returned
+// tensors are views onto the mapping, so processes loading the same file
+// share one copy through the page cache.
+//
+// Binary layout, all integers little-endian uint64:
+//   magic "AMUNBIN1", number of entries,
+//   per entry: name length, name, rows, columns, row spacing, byte offset
+//   followed by the data. Every matrix starts on a 64 byte boundary, rows of
+//   proper matrices are padded to 64 bytes. Vectors are stored contiguously
+//   so they can be viewed as either a row or a column.
 class NpzConverter {
   private:
-    class NpyMatrixWrapper {
-      public:
-        NpyMatrixWrapper(const cnpy::NpyArray& npy)
-        : npy_(npy) {}
-
-        size_t size() const {
-          return size1() * size2();
-        }
-
-        float* data() const {
-          return (float*)npy_.data;
-        }
-
-        float operator()(size_t i, size_t j) const {
-          return ((float*)npy_.data)[i * size2() + j];
-        }
-
-        size_t size1() const {
-          return npy_.shape[0];
-        }
-
-        size_t size2() const {
-          if(npy_.shape.size() == 1)
-            return 1;
-          else
-            return npy_.shape[1];
-        }
-
-      private:
-        const cnpy::NpyArray& npy_;
+    struct Entry {
+      const float* data;
+      size_t rows;
+      size_t cols;
+      size_t spacing;
     };
 
   public:
+    // copy: the tensors of a binary model own a copy of their data
+    // instead of viewing the mapping
+    NpzConverter(const std::string& file, bool copy = false);
+    ~NpzConverter();
+
+    bool has(std::string key) const;
+
+    void Destruct();
+
+    mblas::MappedTensor operator[](const std::string& key) const;
+
+    mblas::MappedTensor getFirstOfMany(const std::vector<std::pair<std::string, bool>> keys) const;
 
-    typedef blaze::CustomMatrix<float, blaze::unaligned,
-      blaze::unpadded, blaze::rowMajor> BlazeWrapper;
-
-    bool has(std::string key) const {
-      auto it = model_.find(key);
-      return (it != model_.end());
-    }
-
-
-    NpzConverter(const std::string& file)
-      : model_(cnpy::npz_load(file)),
-        destructed_(false) {
-      }
-
-    ~NpzConverter() {
-      if(!destructed_)
-        model_.destruct();
-    }
-
-    void Destruct() {
-      model_.destruct();
-      destructed_ = true;
-    }
-
-    mblas::Tensor operator[](const std::string& key) const {
-      BlazeWrapper matrix;
-      auto it = model_.find(key);
-      if(it != model_.end()) {
-        NpyMatrixWrapper np(it->second);
-        matrix = BlazeWrapper(np.data(), np.size1(), np.size2());
-      }
-      else {
-        if (key.find("gamma") == std::string::npos) {
-          std::cerr << "Missing " << key << std::endl;
-        }
-      }
-
-      mblas::Tensor ret;
-      ret = matrix;
-      return std::move(ret);
-    }
-
-    mblas::Tensor getFirstOfMany(const std::vector<std::pair<std::string, bool>> keys) const {
-      BlazeWrapper matrix;
-      for (auto key : keys) {
-        auto it = model_.find(key.first);
-        if(it != model_.end()) {
-          NpyMatrixWrapper np(it->second);
-          matrix = BlazeWrapper(np.data(), np.size1(), np.size2());
-          mblas::Tensor ret;
-          if (key.second) {
-            const auto matrix2 = blaze::trans(matrix);
-            ret = matrix2;
-          } else {
-            ret = matrix;
-          }
-          return std::move(ret);
-        }
-      }
-      std::cerr << "Matrix not found: " << keys[0].first << "\n";
-
-      mblas::Tensor ret;
-      return std::move(ret);
-    }
-
-    mblas::Tensor operator()(const std::string& key,
-                                   bool transpose) const {
-      BlazeWrapper matrix;
-      auto it = model_.find(key);
-      if(it != model_.end()) {
-        NpyMatrixWrapper np(it->second);
-        matrix = BlazeWrapper(np.data(), np.size1(), np.size2());
-      } else {
-          std::cerr << "Missing " << key << std::endl;
-      }
-      mblas::Tensor ret;
-      if (transpose) {
-        const auto matrix2 = blaze::trans(matrix);
-        ret = matrix2;
-      } else {
-        ret = matrix;
-      }
-      return std::move(ret);
-    }
+    mblas::MappedTensor operator()(const std::string& key,
+                                   bool transpose) const;
+
+    static bool IsBinary(const std::string& file);
+
+    // Writes the .npz model to the binary format. The output layer is stored
+    // already transposed when it is tied to the target embeddings.
+    static void ConvertToBinary(const std::string& npzFile, const std::string& binFile);
 
   private:
+    bool Find(const std::string& key, Entry& entry) const;
+    mblas::MappedTensor Get(const Entry& entry, bool transpose) const;
+    void Map(const std::string& file);
+
     cnpy::npz_t model_;
     bool destructed_;
+    bool copy_;
+
+    std::shared_ptr<const void> mapping_;
+    std::map<std::string, Entry> mapped_;
 };
 
 }
 }
-
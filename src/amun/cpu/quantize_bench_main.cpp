@@ -0,0 +1,85 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include "cpu/npz_converter.h"
+#include "cpu/mblas/tensor.h"
+
+using namespace amunmt::CPU;
+
+namespace {
+
+template <class F>
+double Milliseconds(F f, unsigned iterations) {
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < iterations; ++i) {
+    f();
+  }
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+}
+
+// Times the output layer of a model, the largest product in decoding, in
+// fp32 and int8 and reports how far the int8 log-probabilities are off.
+int main(int argc, char** argv) {
+  if (argc < 2 || argc > 4) {
+    std::cerr << "Usage: " << argv[0] << " model.npz [rows=12] [iterations=50]" << std::endl;
+    return 1;
+  }
+  unsigned rows = argc > 2 ? std::atoi(argv[2]) : 12;
+  unsigned iterations = argc > 3 ? std::atoi(argv[3]) : 50;
+
+  NpzConverter model(argv[1]);
+  mblas::MappedTensor W4 = model.getFirstOfMany({std::make_pair(std::string("ff_logit_W"), false),
+                                                 std::make_pair(std::string("Wemb_dec"), true),
+                                                 std::make_pair(std::string("Wemb"), true)});
+  if (W4.rows() == 0) {
+    return 1;
+  }
+  mblas::QuantizedMatrix W4q(W4);
+
+  // decoder states before the output layer are tanh activations
+  std::mt19937 gen(1234);
+  std::normal_distribution<float> normal;
+  mblas::Tensor t(rows, W4.rows());
+  for (unsigned i = 0; i < t.rows(); ++i) {
+    for (unsigned j = 0; j < t.columns(); ++j) {
+      t(i, j) = std::tanh(normal(gen));
+    }
+  }
+
+  mblas::Tensor fp32;
+  mblas::Tensor int8(rows, W4.columns());
+  double fp32Time = Milliseconds([&]() { fp32 = t * W4; }, iterations);
+  double int8Time = Milliseconds([&]() { W4q.Multiply(int8, t); }, iterations);
+
+  mblas::LogSoftmax(fp32);
+  mblas::LogSoftmax(int8);
+
+  double maxDiff = 0.0;
+  double sumDiff = 0.0;
+  unsigned sameBest = 0;
+  for (unsigned i = 0; i < rows; ++i) {
+    unsigned best1 = 0, best2 = 0;
+    for (unsigned j = 0; j < fp32.columns(); ++j) {
+      double diff = std::abs(fp32(i, j) - int8(i, j));
+      maxDiff = std::max(maxDiff, diff);
+      sumDiff += diff;
+      if (fp32(i, j) > fp32(i, best1)) best1 = j;
+      if (int8(i, j) > int8(i, best2)) best2 = j;
+    }
+    sameBest += best1 == best2;
+  }
+
+  std::cout << "Output layer " << W4.rows() << "x" << W4.columns()
+            << ", " << rows << " rows" << std::endl;
+  std::cout << "fp32: " << fp32Time << " ms" << std::endl;
+  std::cout << "int8: " << int8Time << " ms, " << fp32Time / int8Time << "x" << std::endl;
+  std::cout << "log-prob error: max " << maxDiff
+            << ", mean " << sumDiff / (rows * fp32.columns()) << std::endl;
+  std::cout << "same best word: " << sameBest << "/" << rows << std::endl;
+  return 0;
+}
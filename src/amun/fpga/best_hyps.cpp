@@ -40,6 +40,7 @@ void BestHyps::CalcBeam(
     const Beam& prevHyps,
     const std::vector<ScorerPtr>& scorers,
     const Words& filterIndices,
+    HypothesisArena& arena,
     std::vector<Beam>& beams,
     std::vector<uint>& beamSizes
     )
@@ -116,10 +117,10 @@ void BestHyps::CalcBeam(
 
     HypothesisPtr hyp;
     if (returnAlignment) {
-      //hyp.reset(new Hypothesis(prevHyps[hypIndex], wordIndex, hypIndex, cost,
-      //                         GetAlignments(scorers, hypIndex)));
+      //hyp = arena.New(prevHyps[hypIndex], wordIndex, hypIndex, cost,
+      //                GetAlignments(scorers, hypIndex));
     } else {
-      hyp.reset(new Hypothesis(prevHyps[hypIndex], wordIndex, hypIndex, cost));
+      hyp = arena.New(prevHyps[hypIndex], wordIndex, hypIndex, cost);
     }
 
     if(doBreakdown) {
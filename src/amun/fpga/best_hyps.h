@@ -23,6 +23,7 @@ public:
       const Beam& prevHyps,
       const std::vector<ScorerPtr>& scorers,
       const Words& filterIndices,
+      HypothesisArena& arena,
       std::vector<Beam>& beams,
       std::vector<uint>& beamSizes
       );
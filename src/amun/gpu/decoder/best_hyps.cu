@@ -7,12 +7,12 @@ namespace GPU {
 
 BestHyps::BestHyps(const God &god)
       : BaseBestHyps(god),
-        keys_(god.Get<unsigned>("beam-size") * god.Get<unsigned>("mini-batch")),
-        costs_(god.Get<unsigned>("beam-size") * god.Get<unsigned>("mini-batch")),
-        maxBeamSize_(god.Get<unsigned>("beam-size"))
+        keys_(god.GetOptions().beamSize * god.GetOptions().miniBatch),
+        costs_(god.GetOptions().beamSize * god.GetOptions().miniBatch),
+        maxBeamSize_(god.GetOptions().beamSize)
 {
   if (!god_.UseFusedSoftmax()) {
-    NthElement *obj = new NthElement(god.Get<unsigned>("beam-size"), god.Get<unsigned>("mini-batch"));
+    NthElement *obj = new NthElement(god.GetOptions().beamSize, god.GetOptions().miniBatch);
     nthElement_.reset(obj);
   }
 }
@@ -69,6 +69,7 @@ void  BestHyps::CalcBeam(
     const Beam& prevHyps,
     const std::vector<ScorerPtr>& scorers,
     const Words& filterIndices,
+    HypothesisArena& arena,
     std::vector<Beam>& beams,
     std::vector<unsigned>& beamSizes)
 {
@@ -101,7 +102,7 @@ void  BestHyps::CalcBeam(
     mblas::Vector<NthOutBatch> &nBest = *static_cast<mblas::Vector<NthOutBatch>*>(scorers[0]->GetNBest());
     nBest.newSize(beamSizeSum);
 
-    bool doSoftmax = maxBeamSize_ > 1 || god_.Get<bool>("n-best");
+    bool doSoftmax = maxBeamSize_ > 1 || god_.ReturnNBestList();
     //cerr << "doSoftmax=" << doSoftmax << endl;
 
     BEGIN_TIMER("GetProbs.LogSoftmaxAndNBest");
@@ -158,10 +159,10 @@ void  BestHyps::CalcBeam(
 
     HypothesisPtr hyp;
     if (returnAttentionWeights_) {
-      hyp.reset(new Hypothesis(prevHyps[hypIndex], wordIndex, hypIndex, cost,
-                               GetAlignments(scorers, hypIndex)));
+      hyp = arena.New(prevHyps[hypIndex], wordIndex, hypIndex, cost,
+                      GetAlignments(scorers, hypIndex));
     } else {
-      hyp.reset(new Hypothesis(prevHyps[hypIndex], wordIndex, hypIndex, cost));
+      hyp = arena.New(prevHyps[hypIndex], wordIndex, hypIndex, cost);
     }
 
     //cerr << "god_.ReturnNBestList()=" << god_.ReturnNBestList() << endl;
@@ -189,6 +190,8 @@ void  BestHyps::CalcBeam(
     beams[batchMap[i]].push_back(hyp);
   }
 
+  Prune(beams, beamSizes);
+
   PAUSE_TIMER("CalcBeam");
 }
 
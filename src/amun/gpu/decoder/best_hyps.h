@@ -38,6 +38,7 @@ class BestHyps : public BaseBestHyps
         const Beam& prevHyps,
         const std::vector<ScorerPtr>& scorers,
         const Words& filterIndices,
+        HypothesisArena& arena,
         std::vector<Beam>& beams,
         std::vector<unsigned>& beamSizes);
 
@@ -28,7 +28,7 @@ EncoderDecoder::EncoderDecoder(
     model_(model),
     encoder_(new Encoder(model_, config)),
     decoder_(new Decoder(god, model_, config)),
-    indices_(god.Get<unsigned>("beam-size")),
+    indices_(god.GetOptions().beamSize),
     SourceContext_(new mblas::Tensor())
 {
   BEGIN_TIMER("EncoderDecoder");
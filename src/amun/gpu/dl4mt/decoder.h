@@ -139,7 +139,7 @@ class Decoder {
       public:
         Alignment(const God &god, const Weights& model)
           : w_(model)
-          , dBatchMapping_(god.Get<unsigned>("mini-batch") * god.Get<unsigned>("beam-size"), 0)
+          , dBatchMapping_(god.GetOptions().miniBatch * god.GetOptions().beamSize, 0)
         {}
 
         void Init(const mblas::Tensor& SourceContext) {
@@ -9,6 +9,7 @@
 #include "common/logging.h"
 #include "common/threadpool.h"
 #include "common/search.h"
+#include "common/prefix_search.h"
 #include "common/printer.h"
 #include "common/sentence.h"
 #include "common/sentences.h"
@@ -27,9 +28,9 @@ void init(const std::string& options) {
 
 boost::python::list translate(boost::python::list& in)
 {
-  size_t miniSize = god_.Get<size_t>("mini-batch");
-  size_t maxiSize = god_.Get<size_t>("maxi-batch");
-  int miniWords = god_.Get<int>("mini-batch-words");
+  size_t miniSize = god_.GetOptions().miniBatch;
+  size_t maxiSize = god_.GetOptions().maxiBatch;
+  int miniWords = god_.GetOptions().miniBatchWords;
 
   std::vector<std::future< std::shared_ptr<Histories> >> results;
   SentencesPtr maxiBatch(new Sentences());
@@ -96,8 +97,27 @@ boost::python::list translate(boost::python::list& in)
   return output;
 }
 
+std::shared_ptr<PrefixSearch> newSession(const std::string& source)
+{
+  return std::shared_ptr<PrefixSearch>(new PrefixSearch(god_, source));
+}
+
+boost::python::list translatePrefix(PrefixSearch& session, const std::string& prefix)
+{
+  boost::python::list output;
+  for (const std::string& translation : session.Translate(prefix)) {
+    output.append(translation);
+  }
+  return output;
+}
+
 BOOST_PYTHON_MODULE(libamunmt)
 {
   boost::python::def("init", init);
   boost::python::def("translate", translate);
+
+  // session = Session(source); session.translate(prefix) for every keystroke
+  boost::python::class_<PrefixSearch, std::shared_ptr<PrefixSearch>, boost::noncopyable>("Session", boost::python::no_init)
+    .def("__init__", boost::python::make_constructor(newSession))
+    .def("translate", translatePrefix);
 }
@@ -0,0 +1,16 @@
+#!/usr/bin/env python
+
+import libamunmt as nmt
+import sys
+
+nmt.init(sys.argv[1])
+
+# completes the translation of every input line while the reference
+# translation is "typed" one word at a time
+for line in sys.stdin:
+    source, reference = line.rstrip().split(" ||| ")
+    session = nmt.Session(source)
+    words = reference.split()
+    for i in range(len(words) + 1):
+        prefix = " ".join(words[:i])
+        print(prefix + " => " + session.translate(prefix)[0])